@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "timing.hpp"
+
+// One measured figure, reported as a JSON object
+struct BenchResult {
+    std::string name;       // e.g. "decode.BMP280.batch"
+    std::string unit;       // e.g. "frames/s"
+    double value;
+};
+
+using BenchResults = std::vector<BenchResult>;
+
+// Repeat each measurement for at least this long
+static constexpr uint64_t MIN_RUN_NS = 200000000;
+
+// Call body() until MIN_RUN_NS has passed and return items per second,
+// where each call processes items_per_call items
+template <typename Body>
+double measureRate(size_t items_per_call, Body&& body) {
+    uint64_t start = monotonicNowNs();
+    uint64_t elapsed = 0;
+    size_t calls = 0;
+    do {
+        body();
+        calls++;
+        elapsed = monotonicNowNs() - start;
+    } while (elapsed < MIN_RUN_NS);
+    return static_cast<double>(calls) * items_per_call * 1e9 / elapsed;
+}
+
+// Suites, each appends its results
+void benchCompile(BenchResults& results);
+void benchDispatch(BenchResults& results);
+void benchDecode(BenchResults& results, size_t frames);
+void benchEEPROMDump(BenchResults& results);
@@ -0,0 +1,65 @@
+#include "bench.hpp"
+#include <cstdio>
+#include <iostream>
+#include <string>
+
+// i2c-player-bench: runs the benchmark suites and prints the results as
+// JSON so successive runs can be compared
+
+static constexpr size_t DEFAULT_FRAMES = 100000;
+
+static void printUsage(const char* progname) {
+    std::cerr << "Usage: " << progname << " [--suite=<list>] [--frames=<n>]\n"
+              << "  --suite=<list>   Comma-separated suites: compile,dispatch,decode,eeprom (default: all)\n"
+              << "  --frames=<n>     Frames per decode batch (default: 100000)\n";
+}
+
+static bool selected(const std::string& suites, const std::string& name) {
+    return suites.empty() || ("," + suites + ",").find("," + name + ",") != std::string::npos;
+}
+
+static void printJSON(const BenchResults& results) {
+    std::cout << "{\n  \"benchmarks\": [\n";
+    for (size_t i = 0; i < results.size(); i++) {
+        char value[64];
+        std::snprintf(value, sizeof(value), "%.6g", results[i].value);
+        std::cout << "    {\"name\": \"" << results[i].name << "\", \"unit\": \""
+                  << results[i].unit << "\", \"value\": " << value << "}"
+                  << (i + 1 < results.size() ? "," : "") << "\n";
+    }
+    std::cout << "  ]\n}\n";
+}
+
+int main(int argc, char* argv[]) {
+    std::string suites;
+    size_t frames = DEFAULT_FRAMES;
+
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg.substr(0, 8) == "--suite=") {
+            suites = arg.substr(8);
+        } else if (arg.substr(0, 9) == "--frames=") {
+            frames = std::stoul(arg.substr(9));
+        } else {
+            printUsage(argv[0]);
+            return 1;
+        }
+    }
+    if (frames == 0) {
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    try {
+        BenchResults results;
+        if (selected(suites, "compile")) benchCompile(results);
+        if (selected(suites, "dispatch")) benchDispatch(results);
+        if (selected(suites, "decode")) benchDecode(results, frames);
+        if (selected(suites, "eeprom")) benchEEPROMDump(results);
+        printJSON(results);
+        return 0;
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        return 1;
+    }
+}
@@ -0,0 +1,48 @@
+#include "bench.hpp"
+#include "script_compiler.hpp"
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+// Throughput of CSV tokenization and operand decoding through
+// ScriptCompiler::compileFile
+
+static constexpr size_t SCRIPT_LINES = 20000;
+
+static std::string writeScript(const char* tag, const char* const* lines, size_t variants) {
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("i2c-player-bench-" + std::to_string(getpid()) + "-" + tag + ".csv")).string();
+    std::ofstream out(path);
+    out << "command,addr,reg,data\n";
+    for (size_t i = 0; i < SCRIPT_LINES; i++) {
+        out << lines[i % variants] << "\n";
+    }
+    return path;
+}
+
+void benchCompile(BenchResults& results) {
+    ScriptCompiler compiler;
+
+    // Typical mix of commands, comments and blank lines
+    static const char* const mixed[] = {
+        "WRITE,0x76,0xF4,0x57",
+        "READ,0x76,0xD0",
+        "READN,0x76,0xF7,6",
+        "# comment",
+        "WRITE16,0x48,0x01,0x8583",
+        "POLL,0x76,0xF3,0x08,0x00,100,1",
+        "DELAY_US,250",
+        ""
+    };
+    std::string path = writeScript("mixed", mixed, sizeof(mixed) / sizeof(mixed[0]));
+    results.push_back({"compile.mixed", "lines/s",
+                       measureRate(SCRIPT_LINES, [&]() { compiler.compileFile(path); })});
+    std::filesystem::remove(path);
+
+    // Three hex operands per line, dominated by operand decoding
+    static const char* const hex[] = {"WRITE,0x76,0xF4,0x57"};
+    path = writeScript("hex", hex, 1);
+    results.push_back({"compile.hex_operands", "operands/s",
+                       measureRate(SCRIPT_LINES * 3, [&]() { compiler.compileFile(path); })});
+    std::filesystem::remove(path);
+}
@@ -0,0 +1,93 @@
+#include "bench.hpp"
+#include "parsers/ads1015_parser.hpp"
+#include "parsers/bh1750_parser.hpp"
+#include "parsers/bmp280_parser.hpp"
+#include "parsers/veml7700_parser.hpp"
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Compares one-frame-per-call decode() against decodeBatch() over the same
+// captured frames and reports frames per second for each path
+
+struct DecodeRates {
+    double single_fps;
+    double batch_fps;
+    double max_diff;        // Largest difference between the two paths
+};
+
+// Value of a named field, NaN if decode() did not produce it (e.g. the
+// VEML7700 configuration heuristic)
+static float fieldValue(const DecodeResult& result, const char* name) {
+    for (size_t i = 0; i < result.count; i++) {
+        if (std::strcmp(result.fields[i].name, name) == 0) {
+            return result.fields[i].value;
+        }
+    }
+    return NAN;
+}
+
+static DecodeRates benchParser(const I2CDeviceParser& parser, size_t frames) {
+    BatchLayout layout = parser.batchLayout();
+
+    std::mt19937 rng(1234);
+    std::vector<uint8_t> data(frames * layout.frame_size);
+    for (auto& byte : data) byte = rng();
+
+    std::vector<std::vector<float>> single(layout.columns, std::vector<float>(frames));
+    std::vector<std::vector<float>> batch(layout.columns, std::vector<float>(frames));
+    std::vector<float*> batch_columns;
+    for (auto& column : batch) batch_columns.push_back(column.data());
+
+    // One frame per virtual call through the vector-based interface
+    std::vector<uint8_t> frame;
+    DecodeResult result;
+    double single_fps = measureRate(frames, [&]() {
+        for (size_t i = 0; i < frames; i++) {
+            const uint8_t* f = data.data() + i * layout.frame_size;
+            frame.assign(f, f + layout.frame_size);
+            parser.decode(frame, result);
+            for (size_t c = 0; c < layout.columns; c++) {
+                single[c][i] = fieldValue(result, layout.column[c].name);
+            }
+        }
+    });
+
+    double batch_fps = measureRate(frames, [&]() {
+        parser.decodeBatch(data.data(), frames, layout.frame_size, batch_columns.data());
+    });
+
+    double max_diff = 0.0;
+    for (size_t c = 0; c < layout.columns; c++) {
+        for (size_t i = 0; i < frames; i++) {
+            if (std::isnan(single[c][i])) continue;
+            max_diff = std::max(max_diff, std::fabs(double(single[c][i]) - batch[c][i]));
+        }
+    }
+    return {single_fps, batch_fps, max_diff};
+}
+
+void benchDecode(BenchResults& results, size_t frames) {
+    struct Entry {
+        const char* name;
+        std::unique_ptr<I2CDeviceParser> parser;
+    };
+    Entry entries[] = {
+        {"BMP280", std::make_unique<BMP280Parser>()},
+        {"ADS1015", std::make_unique<ADS1015Parser>()},
+        {"BH1750", std::make_unique<BH1750Parser>()},
+        {"VEML7700", std::make_unique<VEML7700Parser>()}
+    };
+
+    for (const auto& entry : entries) {
+        DecodeRates r = benchParser(*entry.parser, frames);
+        std::string prefix = std::string("decode.") + entry.name;
+        results.push_back({prefix + ".single", "frames/s", r.single_fps});
+        results.push_back({prefix + ".batch", "frames/s", r.batch_fps});
+        results.push_back({prefix + ".max_diff", "abs", r.max_diff});
+    }
+}
@@ -0,0 +1,49 @@
+#include "bench.hpp"
+#include "i2c_player.hpp"
+#include "bus/sim_bus.hpp"
+#include "script_compiler.hpp"
+#include <filesystem>
+#include <fstream>
+#include <unistd.h>
+
+// Per-command execution cost of I2CPlayer::run against a simulated bus
+// that accounts bus time without sleeping
+
+static constexpr int LOOP_COUNT = 10000;
+static constexpr int COMMANDS_PER_ITERATION = 4;
+
+static std::unique_ptr<I2CBus> createBenchBus() {
+    SimTiming timing;
+    timing.realtime = false;
+    auto bus = std::make_unique<SimBus>(timing);
+    bus->attach(0x38, createSimDevice("PCF8574", timing.write_cycle_us));
+    bus->attach(0x76, createSimDevice("BMP280", timing.write_cycle_us));
+    return bus;
+}
+
+static double measureDispatch(const Program& program, bool batch) {
+    I2CPlayer player(createBenchBus(), false, 0, ErrorAction::STOP, 3);
+    player.setBatchMode(batch);
+    return measureRate(LOOP_COUNT * COMMANDS_PER_ITERATION, [&]() { player.run(program); });
+}
+
+void benchDispatch(BenchResults& results) {
+    std::string path = (std::filesystem::temp_directory_path() /
+                        ("i2c-player-bench-" + std::to_string(getpid()) + "-dispatch.csv")).string();
+    {
+        std::ofstream out(path);
+        out << "command,addr,reg,data\n"
+            << "LOOP," << LOOP_COUNT << "\n"
+            << "WRITE1,0x38,0xFE\n"
+            << "WRITE,0x76,0xF4,0x57\n"
+            << "READ,0x76,0xD0\n"
+            << "READN,0x76,0xF7,6\n"
+            << "ENDLOOP\n";
+    }
+    ScriptCompiler compiler;
+    Program program = compiler.compileFile(path);
+    std::filesystem::remove(path);
+
+    results.push_back({"dispatch.sim", "commands/s", measureDispatch(program, false)});
+    results.push_back({"dispatch.sim.batch", "commands/s", measureDispatch(program, true)});
+}
@@ -0,0 +1,34 @@
+#include "bench.hpp"
+#include "parsers/eeprom_parser.hpp"
+#include <iostream>
+#include <random>
+#include <streambuf>
+
+// Hex-dump formatting speed of EEPROMParser with the output discarded
+
+namespace {
+
+class NullBuffer : public std::streambuf {
+protected:
+    int overflow(int c) override { return c; }
+    std::streamsize xsputn(const char* s, std::streamsize n) override {
+        (void)s;
+        return n;
+    }
+};
+
+} // namespace
+
+void benchEEPROMDump(BenchResults& results) {
+    std::vector<uint8_t> image(8192);   // 24C64
+    std::mt19937 rng(1234);
+    for (auto& byte : image) byte = rng();
+
+    EEPROMParser parser;
+    NullBuffer null;
+    std::streambuf* saved = std::cout.rdbuf(&null);
+    double rate = measureRate(image.size(), [&]() { parser.parse(image); });
+    std::cout.rdbuf(saved);
+
+    results.push_back({"eeprom.hexdump", "bytes/s", rate});
+}
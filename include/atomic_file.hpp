@@ -0,0 +1,26 @@
+#pragma once
+
+#include <string>
+
+// Replace path with content atomically: the data goes to a unique temporary
+// file in the same directory (created with mkstemp), which is renamed over
+// path only after it was written and closed without error. Concurrent
+// writers never share a temporary file, and readers see either the old or
+// the new content. Missing parent directories are created.
+// Returns 0 on success or -errno.
+int replaceFile(const std::string& path, const std::string& content);
+
+// Exclusive advisory lock (flock) on "<path>.lock", held for the lifetime
+// of the object, so a read-modify-write of path by several processes is
+// serialized. Locking is best effort: if the lock file cannot be created,
+// the caller proceeds unlocked and replaceFile() still keeps path intact.
+class FileLock {
+public:
+    explicit FileLock(const std::string& path);
+    ~FileLock();
+    FileLock(const FileLock&) = delete;
+    FileLock& operator=(const FileLock&) = delete;
+
+private:
+    int fd;
+};
@@ -0,0 +1,82 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <linux/i2c.h>
+#include "transfer_mode.hpp"
+
+// Bus backend selection
+enum class BusType {
+    AUTO,      // Pick from the adapter's I2C_FUNCS
+    I2C,       // Plain I2C via read/write and I2C_RDWR
+    SMBUS      // SMBus protocol via I2C_SMBUS ioctls
+};
+
+struct BusOptions {
+    BusType type = BusType::AUTO;
+    TransferMode transfer_mode = TransferMode::RDWR;
+    bool pec = false;           // SMBus Packet Error Checking
+};
+
+// Abstract bus backend. Every operation returns 0 on success or a negative
+// errno value on failure; backends never throw from transfer primitives.
+class I2CBus {
+public:
+    virtual ~I2CBus() = default;
+
+    virtual const char* name() const = 0;
+
+    // Device the backend was opened on, identifies the bus in caches
+    const std::string& device() const { return device_path; }
+    void setDevice(const std::string& path) { device_path = path; }
+
+    // Read len bytes starting at reg (register auto-increment)
+    virtual int readRegister(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) = 0;
+    // Write len bytes starting at reg
+    virtual int writeRegister(uint8_t addr, uint8_t reg, const uint8_t* data, uint16_t len) = 0;
+    // Write raw bytes without a register pointer
+    virtual int writeBytes(uint8_t addr, const uint8_t* data, uint16_t len) = 0;
+    // SMBus block read: the device supplies the byte count (at most 32).
+    // On success *len holds the number of bytes stored in data.
+    virtual int readBlockData(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t* len) = 0;
+
+    // Check whether a device acknowledges addr without addressing a
+    // register: 0 if present, -ENXIO/-EREMOTEIO if not, -EBUSY if a kernel
+    // driver owns the address
+    virtual int probe(uint8_t addr) = 0;
+
+    // Combined multi-message transfer; only valid when maxTransferMessages() > 0
+    virtual int transfer(struct i2c_msg* msgs, size_t count) {
+        (void)msgs;
+        (void)count;
+        return -EOPNOTSUPP;
+    }
+    virtual size_t maxTransferMessages() const { return 0; }
+    // Largest payload accepted by a single writeBytes() call
+    virtual size_t maxWriteLength() const = 0;
+
+    // Set adapter-level I2C_RETRIES and I2C_TIMEOUT (ms); -1 leaves a value unchanged
+    virtual int configureAdapter(int retries, int timeout_ms) {
+        (void)retries;
+        (void)timeout_ms;
+        return -EOPNOTSUPP;
+    }
+
+    virtual void printStats(std::ostream& out) const { (void)out; }
+
+private:
+    std::string device_path;
+};
+
+// Addresses probed with a one-byte read rather than a quick/zero-length
+// write, as i2cdetect does: a quick write can corrupt the write protection
+// of some EEPROMs (0x50-0x5F) and lock up some chips (0x30-0x37)
+bool probeByRead(uint8_t addr);
+
+// Open a backend for a /dev/i2c-X device
+std::unique_ptr<I2CBus> createBus(const std::string& device, const BusOptions& options,
+                                  bool verbose = false);
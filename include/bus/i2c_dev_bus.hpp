@@ -0,0 +1,28 @@
+#pragma once
+
+#include "bus/i2c_dev_fd_bus.hpp"
+#include <string>
+
+// Plain I2C backend on a /dev/i2c-X character device
+class I2CDevBus : public I2CDevFdBus {
+public:
+    I2CDevBus(int fd, unsigned long funcs, TransferMode mode);
+
+    const char* name() const override { return "i2c"; }
+
+    int readRegister(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) override;
+    int writeRegister(uint8_t addr, uint8_t reg, const uint8_t* data, uint16_t len) override;
+    int writeBytes(uint8_t addr, const uint8_t* data, uint16_t len) override;
+    int readBlockData(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t* len) override;
+    int probe(uint8_t addr) override;
+
+    int transfer(struct i2c_msg* msgs, size_t count) override;
+    size_t maxTransferMessages() const override;
+    size_t maxWriteLength() const override { return MAX_WRITE_LENGTH; }
+
+private:
+    static constexpr size_t MAX_WRITE_LENGTH = 8192;
+
+    bool rdwr_supported;
+    TransferMode transfer_mode;
+};
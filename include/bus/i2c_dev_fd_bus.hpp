@@ -0,0 +1,33 @@
+#pragma once
+
+#include "bus/i2c_bus.hpp"
+#include <cstdint>
+
+// Common part of the backends on an opened /dev/i2c-X descriptor: owns the
+// fd, caches the address selected with I2C_SLAVE and configures the adapter
+class I2CDevFdBus : public I2CBus {
+public:
+    ~I2CDevFdBus() override;
+
+    int configureAdapter(int retries, int timeout_ms) override;
+    // I2C_SLAVE ioctl counters
+    void printStats(std::ostream& out) const override;
+
+protected:
+    I2CDevFdBus(int fd, unsigned long funcs);
+
+    // Select addr for plain read()/write() and I2C_SMBUS, skipping the
+    // ioctl when it is already selected
+    int selectSlave(uint8_t addr);
+    // Forget the cached address after a failed transfer, so the next
+    // selectSlave() issues the ioctl again
+    void invalidateSlave() { current_slave = -1; }
+
+    int fd;
+    unsigned long funcs;
+
+private:
+    int current_slave;                      // Address selected on fd, -1 if unknown
+    unsigned long slave_ioctls_issued;
+    unsigned long slave_ioctls_skipped;
+};
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <array>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+#include "bus/i2c_bus.hpp"
+#include "bus/sim_devices.hpp"
+
+// Cost model of the simulated bus
+struct SimTiming {
+    uint32_t clock_hz = 100000;         // SCL frequency
+    uint32_t byte_cost_ns = 0;          // Extra cost per transferred byte (driver, clock stretching)
+    uint32_t transaction_cost_ns = 0;   // Fixed cost per transaction (ioctl, scheduling)
+    double nak_rate = 0.0;              // Probability of an injected NAK per transaction
+    bool realtime = true;               // Sleep for the modeled duration
+    uint32_t seed = 1;                  // Seed of the NAK injection generator
+    uint32_t write_cycle_us = 5000;     // EEPROM tWR
+};
+
+// In-process bus populated with device models. Selected with
+// --device=sim:<config>; an empty config attaches one of each model at
+// its usual address.
+class SimBus : public I2CBus {
+public:
+    explicit SimBus(const SimTiming& timing);
+
+    const char* name() const override { return "sim"; }
+
+    // Attach a model; returns false if one of its addresses is taken
+    bool attach(uint8_t addr, std::unique_ptr<SimDevice> device);
+
+    int readRegister(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) override;
+    int writeRegister(uint8_t addr, uint8_t reg, const uint8_t* data, uint16_t len) override;
+    int writeBytes(uint8_t addr, const uint8_t* data, uint16_t len) override;
+    int readBlockData(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t* len) override;
+    int probe(uint8_t addr) override;
+
+    int transfer(struct i2c_msg* msgs, size_t count) override;
+    size_t maxTransferMessages() const override;
+    size_t maxWriteLength() const override { return MAX_WRITE_LENGTH; }
+
+    int configureAdapter(int retries, int timeout_ms) override;
+    void printStats(std::ostream& out) const override;
+
+private:
+    // Run the messages of one transaction (repeated starts between them)
+    int execute(struct i2c_msg* msgs, size_t count);
+    void charge(const struct i2c_msg* msgs, size_t count);
+
+    static constexpr size_t MAX_WRITE_LENGTH = 8192;
+
+    SimTiming timing;
+    std::vector<std::unique_ptr<SimDevice>> devices;
+    std::array<SimDevice*, 128> slaves;
+    std::minstd_rand rng;
+    std::uniform_real_distribution<double> chance;
+    uint64_t bus_free_at;               // End of the last modeled transaction
+    unsigned long transactions;
+    unsigned long bytes;
+    unsigned long naks_injected;
+    unsigned long naks_absent;          // No device or device busy
+    uint64_t modeled_ns;
+};
+
+// Build a simulated bus from a config file with lines:
+//   CLOCK,hz | BYTE_NS,ns | TRANSACTION_NS,ns | NAK_RATE,p | REALTIME,0|1 |
+//   SEED,n | WRITE_CYCLE_US,us | DEVICE,type,addr
+std::unique_ptr<I2CBus> createSimBus(const std::string& config, bool verbose);
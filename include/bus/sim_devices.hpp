@@ -0,0 +1,28 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+// Register-level model of an I2C slave for the simulated bus. The bus hands
+// a device the raw bytes of each message, exactly as they would appear on
+// the wire after the address byte.
+class SimDevice {
+public:
+    virtual ~SimDevice() = default;
+
+    // Master write of len bytes (len 0 is a quick write / address probe)
+    virtual void write(uint8_t addr, const uint8_t* data, size_t len) = 0;
+    // Master read of len bytes
+    virtual void read(uint8_t addr, uint8_t* data, size_t len) = 0;
+    // A busy device does not acknowledge its address (EEPROM write cycle)
+    virtual bool busy() const { return false; }
+    // Number of consecutive slave addresses occupied (24C04-24C16 block bits)
+    virtual uint8_t addressSpan() const { return 1; }
+};
+
+// Create a model by part name (BMP280, DS3231, BH1750, VEML7700, ADS1015,
+// PCF8574 or any 24Cxx geometry). write_cycle_us is the EEPROM tWR.
+// Returns nullptr for unknown parts.
+std::unique_ptr<SimDevice> createSimDevice(const std::string& type, uint32_t write_cycle_us);
@@ -0,0 +1,27 @@
+#pragma once
+
+#include "bus/i2c_dev_fd_bus.hpp"
+
+// SMBus backend for SMBus-only adapters, using I2C_SMBUS ioctls
+class SMBusBus : public I2CDevFdBus {
+public:
+    SMBusBus(int fd, unsigned long funcs, bool pec);
+
+    const char* name() const override { return "smbus"; }
+
+    int readRegister(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) override;
+    int writeRegister(uint8_t addr, uint8_t reg, const uint8_t* data, uint16_t len) override;
+    int writeBytes(uint8_t addr, const uint8_t* data, uint16_t len) override;
+    int readBlockData(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t* len) override;
+    int probe(uint8_t addr) override;
+
+    // Command byte plus one I2C block
+    size_t maxWriteLength() const override { return 1 + I2C_SMBUS_BLOCK_MAX; }
+
+    void printStats(std::ostream& out) const override;
+
+private:
+    int access(uint8_t read_write, uint8_t command, uint32_t size, union i2c_smbus_data* data);
+
+    bool pec;
+};
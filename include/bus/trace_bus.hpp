@@ -0,0 +1,114 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include "bus/i2c_bus.hpp"
+#include "mapped_file.hpp"
+
+// Bus trace file layout (host byte order):
+//   header: "I2CT", u16 version, u16 record header size, u64 CLOCK_REALTIME start ns
+//   records: TraceRecord followed by its payload padded to 8 bytes, until a
+//            zero kind or EOF
+enum class TraceKind : uint8_t {
+    END = 0,                // Unwritten space after the last record
+    READ_REGISTER = 1,      // payload: bytes read (len requested)
+    WRITE_REGISTER = 2,     // payload: bytes written
+    WRITE_BYTES = 3,        // payload: bytes written
+    READ_BLOCK_DATA = 4,    // payload: bytes returned by the device
+    TRANSFER = 5,           // payload: per message u16 addr, u16 flags, u16 len, data
+    PROBE = 6               // payload: none
+};
+
+struct TraceRecord {
+    uint64_t timestamp_ns;  // Start of the transaction, relative to the trace start
+    uint32_t duration_ns;
+    int32_t result;         // 0 or negative errno
+    TraceKind kind;
+    uint8_t addr;
+    uint8_t reg;
+    uint8_t messages;       // TRANSFER message count
+    uint32_t len;           // Payload bytes following the record
+};
+static_assert(sizeof(TraceRecord) == 24, "TraceRecord layout is part of the file format");
+
+// Append-only writer into a memory-mapped file. The mapping grows in
+// chunks, so appending a record is a bounds check and a memcpy.
+class TraceWriter {
+public:
+    explicit TraceWriter(const std::string& path);
+    ~TraceWriter();
+    TraceWriter(const TraceWriter&) = delete;
+    TraceWriter& operator=(const TraceWriter&) = delete;
+
+    // Space for a record header plus payload_len bytes; nullptr after a
+    // mapping failure, which stops the trace but never the bus
+    TraceRecord* reserve(size_t payload_len);
+    // Publish the record returned by the last reserve()
+    void commit();
+
+    const std::string& path() const { return file_path; }
+    size_t records() const { return record_count; }
+    size_t bytes() const { return used; }
+
+private:
+    bool grow(size_t needed);
+
+    static constexpr size_t CHUNK_SIZE = 1 << 20;
+
+    std::string file_path;
+    int fd;
+    uint8_t* map;
+    size_t capacity;
+    size_t used;
+    size_t pending;         // Size of the reserved, uncommitted record
+    size_t record_count;
+    bool failed;
+};
+
+// Read-only view of a trace file
+class TraceReader {
+public:
+    explicit TraceReader(const std::string& path);
+
+    // Next record and its payload; false at the end of the trace
+    bool next(const TraceRecord*& record, const uint8_t*& payload);
+    uint64_t startRealtimeNs() const { return start_realtime_ns; }
+
+private:
+    MappedFile file;
+    size_t offset;
+    uint64_t start_realtime_ns;
+};
+
+// Decorator that forwards to another backend and logs every transaction
+class TraceBus : public I2CBus {
+public:
+    TraceBus(std::unique_ptr<I2CBus> inner, const std::string& path);
+
+    const char* name() const override { return inner_bus->name(); }
+
+    int readRegister(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) override;
+    int writeRegister(uint8_t addr, uint8_t reg, const uint8_t* data, uint16_t len) override;
+    int writeBytes(uint8_t addr, const uint8_t* data, uint16_t len) override;
+    int readBlockData(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t* len) override;
+    int probe(uint8_t addr) override;
+
+    int transfer(struct i2c_msg* msgs, size_t count) override;
+    size_t maxTransferMessages() const override { return inner_bus->maxTransferMessages(); }
+    size_t maxWriteLength() const override { return inner_bus->maxWriteLength(); }
+
+    int configureAdapter(int retries, int timeout_ms) override {
+        return inner_bus->configureAdapter(retries, timeout_ms);
+    }
+    void printStats(std::ostream& out) const override;
+
+private:
+    void log(TraceKind kind, uint8_t addr, uint8_t reg, int rc, uint64_t start,
+             const uint8_t* data, size_t len);
+
+    std::unique_ptr<I2CBus> inner_bus;
+    TraceWriter writer;
+    uint64_t origin_ns;
+};
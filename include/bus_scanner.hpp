@@ -0,0 +1,40 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "bus/i2c_bus.hpp"
+
+// Result of probing one bus
+struct BusScan {
+    std::string device;
+    std::string backend;                        // Backend used for the probes
+    std::string error;                          // Set if the bus could not be scanned
+    std::map<uint8_t, std::string> devices;     // Answering address -> identified part
+    uint64_t elapsed_ns = 0;
+};
+
+// First and last address probed, as i2cdetect: the rest is reserved
+constexpr uint8_t SCAN_FIRST_ADDR = 0x03;
+constexpr uint8_t SCAN_LAST_ADDR = 0x77;
+
+// Part name of anything answering at 0x50-0x57: an EEPROM of unknown size
+constexpr const char* UNKNOWN_EEPROM = "unknown EEPROM";
+
+// All /dev/i2c-* adapters, sorted
+std::vector<std::string> listBuses();
+
+// Probe every address of a bus and identify the devices that answer
+BusScan scanBus(const std::string& device, const BusOptions& options);
+
+// Scan several buses in parallel, one thread per bus. Results are in the
+// order of devices.
+std::vector<BusScan> scanBuses(const std::vector<std::string>& devices, const BusOptions& options);
+
+// Identify a device that answered a probe from its registers: "BMP280",
+// "BME280", "DS3231", UNKNOWN_EEPROM, or "?" if no fingerprint matches
+std::string identifyDevice(I2CBus& bus, uint8_t addr);
+
+void printScan(std::ostream& out, const BusScan& scan);
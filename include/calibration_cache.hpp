@@ -0,0 +1,34 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+#include <vector>
+
+// Device calibration blocks keyed by device type, bus and address. Blocks
+// are kept in memory for the run and, when a cache file is set, persisted
+// so later invocations can skip the calibration read.
+class CalibrationCache {
+public:
+    // Default cache file: $XDG_CACHE_HOME/i2c-player/calibration.csv or
+    // ~/.cache/i2c-player/calibration.csv, empty if neither can be resolved
+    static std::string defaultPath();
+
+    // Use a cache file (empty disables persistence) and load its entries
+    void setFile(const std::string& path);
+
+    const std::vector<uint8_t>* find(const std::string& device, const std::string& bus,
+                                     uint8_t addr) const;
+    void store(const std::string& device, const std::string& bus, uint8_t addr,
+               const std::vector<uint8_t>& data);
+
+private:
+    static std::string key(const std::string& device, const std::string& bus, uint8_t addr);
+    // Merge the file's entries into memory; file entries replace equal keys
+    void load();
+    // Write all entries; callers hold the FileLock of path
+    void save() const;
+
+    std::string path;
+    std::map<std::string, std::vector<uint8_t>> entries;
+};
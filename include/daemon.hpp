@@ -0,0 +1,81 @@
+#pragma once
+
+#include <ctime>
+#include <sstream>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "error_action.hpp"
+#include "i2c_player.hpp"
+#include "script_compiler.hpp"
+
+// Serves requests for one bus over an AF_UNIX stream socket, keeping the
+// opened bus, registered parsers, calibration and compiled scripts
+// resident between requests.
+//
+// Requests are text, one command per line:
+//   PING
+//   RUN <script.csv>                 compiled once, recompiled when the file changes
+//   EXEC                             inline script lines, terminated by a line "."
+//   READ <addr> <reg> <len> [device] burst read, decoded if a device is given
+// Every request is answered with "OK <n>\n" or "ERR <n>\n" followed by n
+// bytes of output (parser reports, records, error messages).
+class I2CDaemon {
+public:
+    I2CDaemon(I2CPlayer& player, const std::string& socket_path, bool verbose,
+              ErrorAction action);
+    ~I2CDaemon();
+    I2CDaemon(const I2CDaemon&) = delete;
+    I2CDaemon& operator=(const I2CDaemon&) = delete;
+
+    // Serve until SIGINT or SIGTERM
+    void serve();
+
+    // Default socket: $XDG_RUNTIME_DIR/i2c-player.sock, else /tmp/i2c-player.sock
+    static std::string defaultSocketPath();
+
+private:
+    struct Client {
+        int fd;
+        std::string input;          // Received bytes not yet consumed by a request
+        bool eof;                   // Client shut down its sending side
+    };
+
+    struct CachedScript {
+        struct timespec mtime;
+        off_t size;
+        Program program;
+    };
+
+    void acceptClients();
+    // Append available bytes; false when the client misbehaves or fails.
+    // End of input only sets eof, requests already received are still served.
+    bool receive(Client& client);
+    // Cut one complete request off the client's input
+    bool nextRequest(Client& client, std::string& request);
+    static bool hasRequest(const Client& client);
+    // Execute a request with std::cout/std::cerr captured; false on error
+    bool execute(const std::string& request);
+    const Program& script(const std::string& path);
+    // SAMPLE frames bypass the captured streams, so they cannot reach a client
+    void checkSamples(const Program& program) const;
+    bool reply(Client& client, bool ok);
+
+    static constexpr size_t MAX_REQUEST = 1 << 20;
+    static constexpr int BACKLOG = 16;
+
+    I2CPlayer& player;
+    std::string socket_path;
+    bool verbose;
+    int listen_fd;
+    ScriptCompiler compiler;
+    std::vector<Client> clients;
+    size_t next_client;             // Round-robin start of the next pass
+    std::unordered_map<std::string, CachedScript> scripts;
+    std::ostringstream output;      // Captured output of the current request
+    std::string response;
+};
+
+// Send one request to a daemon and copy its output to stdout.
+// Returns the process exit code.
+int runDaemonClient(const std::string& socket_path, const std::string& request);
@@ -0,0 +1,36 @@
+#pragma once
+
+#include <cstdint>
+#include <map>
+#include <string>
+
+// Devices found by --scan, per bus and address. A run consults it to fail
+// before its first transfer when the script addresses a device that did
+// not answer the last scan of that bus. Only presence is compared; part
+// names are informational, since not every part can be identified.
+class DeviceInventory {
+public:
+    // Default inventory file: $XDG_CACHE_HOME/i2c-player/inventory.csv or
+    // ~/.cache/i2c-player/inventory.csv, empty if neither can be resolved
+    static std::string defaultPath();
+
+    // Use an inventory file (empty disables it) and load its entries
+    void setFile(const std::string& path);
+    const std::string& file() const { return path; }
+
+    // Replace the devices recorded for a bus (address -> part) and save
+    void update(const std::string& bus, const std::map<uint8_t, std::string>& devices);
+
+    // The bus has been scanned, so absent addresses are known to be absent
+    bool scanned(const std::string& bus) const;
+    // Identified part at addr ("?" if unknown), nullptr if nothing answered
+    const std::string* find(const std::string& bus, uint8_t addr) const;
+
+private:
+    void load();
+    // Called with the FileLock of path held
+    void save() const;
+
+    std::string path;
+    std::map<std::string, std::map<uint8_t, std::string>> buses;
+};
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+
+// Memory layout of a 24Cxx serial EEPROM
+struct EEPROMGeometry {
+    const char* name;       // Part name, e.g. "24C64"
+    size_t size;            // Total size in bytes
+    uint16_t page_size;     // Bytes per page write
+    uint8_t addr_bytes;     // Word address width on the bus (1 or 2)
+    uint8_t block_bits;     // High address bits carried in the device address (24C04-24C16)
+};
+
+// Sizes match EEPROMParser::COMMON_SIZES
+inline constexpr std::array<EEPROMGeometry, 8> EEPROM_GEOMETRIES = {{
+    {"24C01",    128,  8, 1, 0},
+    {"24C02",    256,  8, 1, 0},
+    {"24C04",    512, 16, 1, 1},
+    {"24C08",   1024, 16, 1, 2},
+    {"24C16",   2048, 16, 1, 3},
+    {"24C32",   4096, 32, 2, 0},
+    {"24C64",   8192, 32, 2, 0},
+    {"24C128", 16384, 64, 2, 0}
+}};
+
+// Look up a part by name, returns -1 if unknown
+inline int findEEPROMGeometry(const std::string& name) {
+    for (size_t i = 0; i < EEPROM_GEOMETRIES.size(); i++) {
+        if (name == EEPROM_GEOMETRIES[i].name) {
+            return static_cast<int>(i);
+        }
+    }
+    return -1;
+}
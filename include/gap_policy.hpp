@@ -0,0 +1,52 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string>
+
+// Timing requirements of a single device, all in microseconds
+struct DeviceTiming {
+    uint32_t bus_free_us = 0;       // Idle bus time after a transaction with the device
+    uint32_t write_settle_us = 0;   // Time after a write before the device is accessed again
+    uint32_t conversion_us = 0;     // Time after a write before the device can be read
+};
+
+// Inserts only the gaps each device needs between transactions. Gaps are
+// enforced lazily right before the next transaction, as absolute deadlines,
+// so time spent executing other commands counts towards them.
+class GapPolicy {
+public:
+    GapPolicy();
+
+    void setDefault(const DeviceTiming& timing);
+    void setProfile(uint8_t addr, const DeviceTiming& timing);
+    // Load profiles from a side file with lines: addr,bus_free_us,settle_us,conversion_us.
+    // They outlive resetProfiles(), unlike profiles declared by a script.
+    void loadFile(const std::string& filename);
+    // Drop script-declared profiles, keeping only those of loadFile()
+    void resetProfiles();
+    // True once at least one device profile has been declared
+    bool configured() const { return has_profiles; }
+    // True if the device's own profile declares any nonzero gap
+    bool needsGap(uint8_t addr) const;
+    void reset();
+
+    void beforeTransaction(uint8_t addr, bool is_read);
+    void afterTransaction(uint8_t addr, bool is_write);
+
+private:
+    const DeviceTiming& profile(uint8_t addr) const;
+
+    static constexpr size_t ADDR_COUNT = 128;
+
+    DeviceTiming default_timing;
+    std::array<DeviceTiming, ADDR_COUNT> profiles;
+    std::array<bool, ADDR_COUNT> has_profile;
+    std::array<DeviceTiming, ADDR_COUNT> file_profiles;   // Restored by resetProfiles()
+    std::array<bool, ADDR_COUNT> has_file_profile;
+    std::array<uint64_t, ADDR_COUNT> last_write_end;  // Per device, CLOCK_MONOTONIC ns
+    uint64_t last_end;                                // Last transaction on the bus
+    int last_addr;
+    bool has_profiles;
+    bool has_file_profiles;
+};
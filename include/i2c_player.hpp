@@ -5,6 +5,17 @@
 #include <memory>
 #include <unordered_map>
 #include "error_action.hpp"
+#include "bus/i2c_bus.hpp"
+#include "script_compiler.hpp"
+#include "eeprom_geometry.hpp"
+#include "timing.hpp"
+#include "gap_policy.hpp"
+#include "retry_engine.hpp"
+#include "sample_writer.hpp"
+#include "record_emitter.hpp"
+#include "calibration_cache.hpp"
+#include "device_inventory.hpp"
+#include "latency_stats.hpp"
 #include "parsers/i2c_device_parser.hpp"
 
 class I2CPlayer {
@@ -12,37 +23,131 @@ public:
     I2CPlayer(const std::string& device, bool verbose_mode = false,
               int wait_ms = 1, ErrorAction action = ErrorAction::STOP,
               int retries = 3);
+    I2CPlayer(std::unique_ptr<I2CBus> bus_backend, bool verbose_mode = false,
+              int wait_ms = 1, ErrorAction action = ErrorAction::STOP,
+              int retries = 3);
     ~I2CPlayer();
 
+    // Play a script; "-" and other non-regular files (pipes) are streamed
     void playFile(const std::string& filename);
+    // Execute a script read from a pipe while it is still being parsed
+    void playStream(const std::string& path);
+    // Burst-read len bytes and print them decoded as device, or as hex
+    // bytes if device is empty. Throws if the read fails.
+    void readFrame(uint8_t addr, uint8_t reg, uint16_t len, const std::string& device);
+    // Re-issue a --trace capture, at its recorded pace or back to back
+    void replayTrace(const std::string& filename, bool original_timing);
+    void run(const Program& program);
+    void printStats() const;
     void registerParser(const std::string& device_name, 
                        std::unique_ptr<I2CDeviceParser> parser);
+    void setBatchMode(bool enable);
+    void loadTimingFile(const std::string& filename);
+    void setBackoff(BackoffPolicy policy, uint32_t base_us);
+    // Hand retries to the adapter (I2C_RETRIES) and/or set I2C_TIMEOUT
+    void setKernelRetries(bool offload, int timeout_ms);
+    // Destination of SAMPLE frames ("-" for stdout) and ring depth in frames
+    void setSampleOutput(const std::string& path, SampleFormat format, size_t ring_frames);
+    const std::string& sampleOutput() const { return sample_path; }
+    // Persist calibration blocks to this file, empty keeps them in memory only
+    void setCalibrationCache(const std::string& path);
+    // Check scripts against the devices found by --scan, empty disables the check
+    void setInventory(const std::string& path);
+    // Program EEPROM FILE commands differentially, like SYNC
+    void setEEPROMSync(bool enable);
+    // How PRINT_RECORD renders decoded records
+    void setOutputFormat(OutputFormat format);
+    // Collect per-command latency histograms and print them after each run
+    void setStats(bool enable);
 
 private:
-    // I2C operations
-    uint8_t readByte(uint8_t addr, uint8_t reg);
-    void writeByte(uint8_t addr, uint8_t reg, uint8_t data);
-    void writeSingleByte(uint8_t addr, uint8_t data);
-    void write16Bit(uint8_t addr, uint8_t reg, uint16_t data);
-    bool pollRegister(uint8_t addr, uint8_t reg, uint8_t mask, uint8_t expected,
-                     int timeout_ms, int interval_ms);
+    // I2C operations, returning 0 or a negative errno value
+    int readByte(uint8_t addr, uint8_t reg, uint8_t& data);
+    int readBlock(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len);
+    int readBlockData(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t& len);
+    int writeByte(uint8_t addr, uint8_t reg, uint8_t data);
+    int writeSingleByte(uint8_t addr, uint8_t data);
+    int write16Bit(uint8_t addr, uint8_t reg, uint16_t data);
+    // Wait for the conditions of a POLL; false on timeout
+    bool poll(const PollSpec& spec, PollStats& stats);
     void writeFile(uint8_t addr, uint8_t reg, const std::string& filename);
-    void executeSequence(const std::vector<std::string>& sequence, int iterations);
+    std::vector<uint8_t> loadFile(const std::string& filename);
+    int calibrate(uint8_t addr, const std::string& device);
+
+    // EEPROM page programming
+    void writeEEPROM(uint8_t addr, size_t offset, const std::string& filename,
+                     const EEPROMGeometry& geometry);
+    void writeEEPROMPage(uint8_t addr, const EEPROMGeometry& geometry, size_t offset,
+                         const uint8_t* data, uint16_t len);
+    int waitWriteCycle(uint8_t addr, const uint8_t* word_addr, uint8_t addr_bytes);
+    // Read back, compare page by page, write only changed pages and verify
+    void syncEEPROM(uint8_t addr, size_t offset, const std::string& filename,
+                    const EEPROMGeometry& geometry);
+    int readEEPROM(uint8_t addr, const EEPROMGeometry& geometry, size_t offset,
+                   uint8_t* data, size_t len);
+
+    // Program execution
+    void beginRun(const Program& program);
+    void executeProgram(const Program& program);
+    void endRun();
+    void executeRange(const Program& program, size_t begin, size_t end);
+    void executeLoop(const Program& program, size_t loop_index);
+    void executePeriodicLoop(const Program& program, size_t loop_index);
+    void printLoopStats(const Program& program) const;
+    void printRecord(const std::string& device);
+    size_t frameSize(const Program& program, size_t begin, size_t end) const;
+    void startSampler(const Program& program);
+    // Throw before any transfer if the program addresses a device the
+    // inventory lists as absent on this bus
+    void checkInventory(const Program& program) const;
+    void finishSampler();
+    void executeInstruction(const Program& program, const Instruction& ins);
+
+    // Batched execution of independent bus commands
+    void planBatches(const Program& program);
+    void executeBatch(const Program& program, size_t begin, size_t end);
 
     // Utility functions
-    std::string trim(const std::string& str);
-    int hexToInt(const std::string& hex);
-    bool checkNAK(const char* operation);
+    // Turn a failed transfer into an exception at the command boundary
+    void checkResult(int rc, const char* operation);
+    void printRetries() const;
+    void printLatencyStats();
+
+    // EEPROM write cycle (tWR) limits
+    static constexpr int EEPROM_WRITE_TIMEOUT_MS = 25;
+    static constexpr int EEPROM_POLL_INTERVAL_US = 100;
+    // Largest sequential read issued while syncing an EEPROM
+    static constexpr size_t EEPROM_READ_CHUNK = 256;
 
     // Member variables
-    int i2c_fd;
-    std::string device_path;
+    std::unique_ptr<I2CBus> bus;
     bool verbose;
     std::string csv_directory;
     int i2c_wait_ms;
     ErrorAction error_action;
-    int retry_count;
+    RetryEngine retry;
+    bool batch_mode;
+    bool eeprom_sync;
+    std::vector<uint32_t> batch_ends;       // Per instruction: end of its batchable run
+    std::vector<struct i2c_msg> batch_msgs;
+    std::vector<uint8_t> batch_bytes;
+    GapPolicy gaps;
+    std::unordered_map<size_t, PeriodStats> loop_stats;  // Per LOOP_EVERY/SAMPLE instruction
+    std::unordered_map<size_t, PollStats> poll_stats;    // Per Program::polls entry
+    std::string sample_path;
+    SampleFormat sample_format;
+    size_t sample_ring_frames;
+    std::vector<uint16_t> sample_devices;   // Program::strings index -> writer device id
+    std::unique_ptr<SampleWriter> sampler;
+    CalibrationCache calibrations;
+    DeviceInventory inventory;
     std::vector<uint8_t> record_buffer;
+    std::vector<uint8_t> read_scratch;      // READN target when bytes are not recorded
     bool recording;
+    OutputFormat output_format;
+    RecordEmitter emitter;
+    DecodeResult decoded;
+    LatencyStats latency;
+    uint64_t stats_start_ns;                // Wall-clock origin of the current --stats run
     std::unordered_map<std::string, std::unique_ptr<I2CDeviceParser>> parsers;
 };
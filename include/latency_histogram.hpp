@@ -0,0 +1,33 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// Log-linear latency histogram in the style of HdrHistogram: exact below
+// 16 ns, then 16 sub-buckets per power of two (<= 6.25% error). The bucket
+// array is fixed, so recording never allocates.
+class LatencyHistogram {
+public:
+    void record(uint64_t ns);
+
+    uint64_t count() const { return samples; }
+    uint64_t total() const { return sum; }
+    uint64_t max() const { return maximum; }
+    // Upper bound of the bucket holding the p-th fraction of samples
+    uint64_t percentile(double p) const;
+
+private:
+    static constexpr int SUB_BITS = 4;
+    static constexpr int SUB_BUCKETS = 1 << SUB_BITS;
+    static constexpr int MAX_MAGNITUDE = 47;    // ~39 hours; larger values are clamped
+    static constexpr size_t BUCKETS = (MAX_MAGNITUDE - SUB_BITS + 2) * SUB_BUCKETS;
+
+    static size_t bucketIndex(uint64_t ns);
+    static uint64_t bucketUpperBound(size_t index);
+
+    std::array<uint32_t, BUCKETS> buckets{};
+    uint64_t samples = 0;
+    uint64_t sum = 0;
+    uint64_t maximum = 0;
+};
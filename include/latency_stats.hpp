@@ -0,0 +1,86 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "latency_histogram.hpp"
+#include "timing.hpp"
+
+// Where wall-clock time goes
+enum class TimeCategory : uint8_t {
+    BUS,        // Bus transfers (first attempts)
+    SLEEP,      // DELAY, inter-command waits, device gaps, poll intervals, periodic loops
+    RETRY,      // Backoff sleeps and retried transfer attempts
+    COMPILE,    // Script compilation
+    DECODE,     // PRINT_RECORD parsing and formatting
+    COUNT
+};
+
+// Per-command and per-address latency histograms plus a wall-clock
+// breakdown. Everything is allocated by enable(); while disabled every
+// hook is a single branch.
+class LatencyStats {
+public:
+    // Times one category for the lifetime of the scope
+    class Scope {
+    public:
+        Scope(LatencyStats& stats_, TimeCategory category_)
+            : stats(stats_), category(category_),
+              start(stats_.enabled() ? monotonicNowNs() : 0) {}
+        ~Scope() {
+            if (start) stats.add(category, monotonicNowNs() - start);
+        }
+        Scope(const Scope&) = delete;
+        Scope& operator=(const Scope&) = delete;
+
+    private:
+        LatencyStats& stats;
+        TimeCategory category;
+        uint64_t start;
+    };
+
+    // Records one command's latency when the scope ends, also on exceptions
+    class CommandScope {
+    public:
+        CommandScope(LatencyStats& stats_, size_t kind_, int addr_)
+            : stats(stats_), kind(kind_), addr(addr_),
+              start(stats_.enabled() ? monotonicNowNs() : 0) {}
+        ~CommandScope() { finish(); }
+        // Record now, e.g. before a trailing inter-command wait
+        void finish() {
+            if (start) stats.recordCommand(kind, addr, monotonicNowNs() - start);
+            start = 0;
+        }
+        CommandScope(const CommandScope&) = delete;
+        CommandScope& operator=(const CommandScope&) = delete;
+
+    private:
+        LatencyStats& stats;
+        size_t kind;
+        int addr;
+        uint64_t start;
+    };
+
+    // Allocate histograms for command kinds 0..kinds-1 and start collecting
+    void enable(size_t kinds);
+    void disable() { active = false; }
+    bool enabled() const { return active; }
+    void reset();
+
+    // addr < 0 for commands without a device
+    void recordCommand(size_t kind, int addr, uint64_t ns);
+    void add(TimeCategory category, uint64_t ns) {
+        category_ns[static_cast<size_t>(category)] += ns;
+    }
+
+    // kind_names[k] labels command kind k
+    void print(std::ostream& out, const char* const* kind_names, uint64_t wall_ns) const;
+
+private:
+    bool active = false;
+    std::vector<LatencyHistogram> commands;
+    std::vector<LatencyHistogram> addresses;    // 128 entries, one per 7-bit address
+    std::array<uint64_t, static_cast<size_t>(TimeCategory::COUNT)> category_ns{};
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file
+class MappedFile {
+public:
+    // Throws "Failed to open <what>: <path>" if the file cannot be opened
+    MappedFile(const std::string& path, const char* what);
+    ~MappedFile();
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    const uint8_t* data() const { return map; }
+    size_t size() const { return length; }
+    std::string_view text() const {
+        return std::string_view(reinterpret_cast<const char*>(map), length);
+    }
+
+private:
+    const uint8_t* map;
+    size_t length;
+};
@@ -9,6 +9,14 @@ public:
     // Parse raw ADC data from the device
     void parse(const std::vector<uint8_t>& buffer) override;
 
+    // Decode raw_value and voltage_V
+    bool decode(const std::vector<uint8_t>& buffer, DecodeResult& result) const override;
+
+    // Columns: raw_value, voltage_V
+    BatchLayout batchLayout() const override;
+    void decodeBatch(const uint8_t* frames, size_t count, size_t stride,
+                     float* const* columns) const override;
+
 private:
     // Constants for voltage conversion
     static constexpr float VOLTAGE_RANGE = 4.096f;  // Full scale range in volts
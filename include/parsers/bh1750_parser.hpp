@@ -9,6 +9,14 @@ public:
     // Parse raw light sensor data
     void parse(const std::vector<uint8_t>& buffer) override;
 
+    // Decode raw_value and illuminance_lux
+    bool decode(const std::vector<uint8_t>& buffer, DecodeResult& result) const override;
+
+    // Columns: raw_value, illuminance_lux
+    BatchLayout batchLayout() const override;
+    void decodeBatch(const uint8_t* frames, size_t count, size_t stride,
+                     float* const* columns) const override;
+
 private:
     // Constants for light intensity conversion
     static constexpr float LUX_CONVERSION_FACTOR = 1.2f;  // Standard conversion for BH1750
@@ -7,27 +7,46 @@
 class BMP280Parser : public I2CDeviceParser {
 public:
     void parse(const std::vector<uint8_t>& buffer) override;
+    bool decode(const std::vector<uint8_t>& buffer, DecodeResult& result) const override;
+
+    // Trim parameters at 0x88-0x9F
+    CalibrationBlock calibrationBlock() const override;
+    bool setCalibration(const std::vector<uint8_t>& data) override;
+
+    // Columns: temperature_degC, pressure_hPa
+    BatchLayout batchLayout() const override;
+    void decodeBatch(const uint8_t* frames, size_t count, size_t stride,
+                     float* const* columns) const override;
 
 private:
-    float calculateTemperature(int32_t adc_T) const;
-    float calculatePressure(int32_t adc_P) const;
-
-    // Temperature calibration constants
-    static constexpr int32_t dig_T1 = 27504;
-    static constexpr int32_t dig_T2 = 26435;
-    static constexpr int32_t dig_T3 = -1000;
-
-    // Pressure calibration constants
-    static constexpr int32_t dig_P1 = 36477;
-    static constexpr int32_t dig_P2 = -10685;
-    static constexpr int32_t dig_P3 = 3024;
-    static constexpr int32_t dig_P4 = 2855;
-    static constexpr int32_t dig_P5 = 140;
-    static constexpr int32_t dig_P6 = -7;
-    static constexpr int32_t dig_P7 = 15500;
-    static constexpr int32_t dig_P8 = -14600;
-    static constexpr int32_t dig_P9 = 6000;
-
-    // Temperature storage for pressure calculation
-    mutable int32_t t_fine;  // Add this for pressure calculation dependency
+    // Trim parameters from registers 0x88-0x9F. The defaults are the
+    // datasheet example values, used until CALIBRATE installs real ones.
+    struct Calibration {
+        int32_t dig_T1 = 27504;
+        int32_t dig_T2 = 26435;
+        int32_t dig_T3 = -1000;
+        int32_t dig_P1 = 36477;
+        int32_t dig_P2 = -10685;
+        int32_t dig_P3 = 3024;
+        int32_t dig_P4 = 2855;
+        int32_t dig_P5 = 140;
+        int32_t dig_P6 = -7;
+        int32_t dig_P7 = 15500;
+        int32_t dig_P8 = -14600;
+        int32_t dig_P9 = 6000;
+    };
+
+    // Stateless compensation steps shared by the single and batch paths;
+    // t_fine from the temperature step is passed on to the pressure step
+    static int32_t compensateTFine(const Calibration& cal, int32_t adc_T);
+    static float temperatureFromTFine(int32_t t_fine);
+    static float pressureFromTFine(const Calibration& cal, int32_t adc_P, int32_t t_fine);
+
+    // Frames per batch chunk, sized so the scratch arrays stay on the stack
+    static constexpr size_t BATCH_CHUNK = 256;
+
+    static constexpr uint8_t CALIBRATION_REG = 0x88;
+    static constexpr uint8_t CALIBRATION_LEN = 24;
+
+    Calibration cal;
 };
@@ -0,0 +1,35 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// One decoded quantity. Names and units are string literals owned by the
+// parser, so filling a result never allocates.
+struct DecodedField {
+    const char* name;       // e.g. "temperature"
+    const char* unit;       // e.g. "degC", empty for plain counts and flags
+    double value;
+    uint8_t precision;      // Decimal places used by text emitters
+};
+
+// Typed output of I2CDeviceParser::decode
+class DecodeResult {
+public:
+    static constexpr size_t MAX_FIELDS = 16;
+
+    void clear(const char* device_name) {
+        device = device_name;
+        count = 0;
+    }
+
+    void add(const char* name, const char* unit, double value, uint8_t precision = 0) {
+        if (count < MAX_FIELDS) {
+            fields[count++] = {name, unit, value, precision};
+        }
+    }
+
+    const char* device = "";
+    std::array<DecodedField, MAX_FIELDS> fields;
+    size_t count = 0;
+};
@@ -10,6 +10,9 @@ public:
     // Parse raw RTC data
     void parse(const std::vector<uint8_t>& buffer) override;
 
+    // Decode the time and date registers
+    bool decode(const std::vector<uint8_t>& buffer, DecodeResult& result) const override;
+
 private:
     // Register bit masks
     static constexpr uint8_t HOUR_12_24_MASK = 0x40;  // 12/24 hour mode flag
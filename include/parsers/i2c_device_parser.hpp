@@ -1,10 +1,62 @@
 #pragma once
 
 #include <vector>
+#include <cstddef>
 #include <cstdint>
+#include "decode_result.hpp"
+
+// Column of a structure-of-arrays batch decode
+struct BatchColumn {
+    const char* name;
+    const char* unit;
+};
+
+// Shape of decodeBatch input and output; columns == 0 means unsupported
+struct BatchLayout {
+    size_t frame_size = 0;              // Bytes per frame
+    size_t columns = 0;                 // Number of output arrays
+    const BatchColumn* column = nullptr;
+};
+
+// Register range holding a device's factory calibration; len 0 = none
+struct CalibrationBlock {
+    uint8_t reg = 0;
+    uint8_t len = 0;
+};
 
 class I2CDeviceParser {
 public:
+    // Print a human-readable report with diagnostics
     virtual void parse(const std::vector<uint8_t>& buffer) = 0;
+
+    // Decode the buffer into typed fields without doing any I/O. Returns
+    // false if the buffer is too short or the device has no typed decoding.
+    virtual bool decode(const std::vector<uint8_t>& buffer, DecodeResult& result) const {
+        (void)buffer;
+        (void)result;
+        return false;
+    }
+
+    // Calibration read by CALIBRATE and installed with setCalibration(),
+    // which returns false if the data cannot be used
+    virtual CalibrationBlock calibrationBlock() const { return {}; }
+    virtual bool setCalibration(const std::vector<uint8_t>& data) {
+        (void)data;
+        return false;
+    }
+
+    virtual BatchLayout batchLayout() const { return {}; }
+
+    // Decode `count` frames, each batchLayout().frame_size bytes and `stride`
+    // bytes apart, into columns[c][0..count). One virtual call covers the
+    // whole batch so the per-frame loops can be vectorized.
+    virtual void decodeBatch(const uint8_t* frames, size_t count, size_t stride,
+                             float* const* columns) const {
+        (void)frames;
+        (void)count;
+        (void)stride;
+        (void)columns;
+    }
+
     virtual ~I2CDeviceParser() = default;
 };
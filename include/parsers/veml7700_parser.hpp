@@ -9,6 +9,14 @@ public:
     // Parse raw light sensor data
     void parse(const std::vector<uint8_t>& buffer) override;
 
+    // Decode raw_value and illuminance_lux, or the configuration fields
+    bool decode(const std::vector<uint8_t>& buffer, DecodeResult& result) const override;
+
+    // Columns: raw_value, illuminance_lux (ALS data frames only)
+    BatchLayout batchLayout() const override;
+    void decodeBatch(const uint8_t* frames, size_t count, size_t stride,
+                     float* const* columns) const override;
+
 private:
     // Gain settings
     enum class Gain {
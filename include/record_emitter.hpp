@@ -0,0 +1,44 @@
+#pragma once
+
+#include <cstdint>
+#include <ostream>
+#include <vector>
+#include "parsers/decode_result.hpp"
+
+// How PRINT_RECORD output is rendered
+enum class OutputFormat {
+    REPORT,    // Parser's own human-readable report with diagnostics
+    TEXT,      // One line per record: device name=value unit ...
+    CSV,       // timestamp_ns,device,fields; header repeated when the device changes
+    JSON,      // One JSON object per line
+    BINARY     // Packed records, see RecordEmitter::emitBinary
+};
+
+// Formats decoded records with std::to_chars into a reused buffer and
+// writes each record with a single call
+class RecordEmitter {
+public:
+    explicit RecordEmitter(std::ostream& out, OutputFormat format = OutputFormat::TEXT);
+
+    void setFormat(OutputFormat format);
+    void emit(const DecodeResult& result, uint64_t timestamp_ns);
+
+private:
+    void emitText(const DecodeResult& result);
+    void emitCSV(const DecodeResult& result, uint64_t timestamp_ns);
+    void emitJSON(const DecodeResult& result, uint64_t timestamp_ns);
+    void emitBinary(const DecodeResult& result, uint64_t timestamp_ns);
+
+    void append(const char* str);
+    void append(char c);
+    void appendKey(const DecodedField& field);
+    void appendNumber(uint64_t value);
+    void appendNumber(double value, uint8_t precision);
+    void appendBytes(const void* data, size_t len);
+
+    std::ostream& out;
+    OutputFormat format;
+    std::vector<char> buffer;
+    const char* csv_device;     // Device of the last CSV header written
+    size_t csv_fields;
+};
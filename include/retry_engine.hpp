@@ -0,0 +1,113 @@
+#pragma once
+
+#include <array>
+#include <cerrno>
+#include <cstdint>
+#include <ostream>
+#include <random>
+#include "error_action.hpp"
+#include "latency_stats.hpp"
+#include "timing.hpp"
+
+// Delay strategy between retry attempts
+enum class BackoffPolicy {
+    FIXED,        // Constant delay
+    EXPONENTIAL,  // Delay doubles with every attempt
+    JITTERED      // Random delay in [0, exponential delay]
+};
+
+// Per-address error counters
+struct AddressErrorStats {
+    unsigned long transfers = 0;
+    unsigned long naks = 0;
+    unsigned long timeouts = 0;
+    unsigned long other_errors = 0;
+    unsigned long retries = 0;
+    unsigned long failures = 0;   // Transfers that failed after all retries
+};
+
+// Shared retry loop for all bus primitives. Transfers report errors as
+// negative errno values and the engine never throws, so a burst of NAKs
+// costs a backoff sleep per attempt and nothing else.
+class RetryEngine {
+public:
+    RetryEngine(int retries, ErrorAction action, uint32_t backoff_us);
+
+    void setBackoff(BackoffPolicy policy, uint32_t base_us);
+    void setRetries(int retries) { retry_count = retries; }
+    // First attempts are charged to BUS, later attempts and backoff to RETRY
+    void setLatencyStats(LatencyStats* stats_) { latency = stats_; }
+    int retries() const { return retry_count; }
+
+    // Number of retries used by the last execute() call
+    int lastRetries() const { return last_retries; }
+
+    static bool isNAK(int error) {
+        return error == ENXIO || error == EIO || error == EREMOTEIO;
+    }
+
+    // Run transfer() until it returns 0 or the retry budget is spent.
+    // Returns 0 or the last negative errno value.
+    template <typename Transfer>
+    int execute(uint8_t addr, Transfer&& transfer) {
+        return execute(addr, transfer, retry_count);
+    }
+
+    // As above with an explicit budget; 0 suits callers that retry on
+    // their own schedule, like POLL
+    template <typename Transfer>
+    int execute(uint8_t addr, Transfer&& transfer, int max_retries) {
+        AddressErrorStats& entry = stats[addr & 0x7F];
+        entry.transfers++;
+
+        for (int attempt = 0; ; attempt++) {
+            uint64_t begin = latency ? monotonicNowNs() : 0;
+            int rc = transfer();
+            if (latency) {
+                latency->add(attempt == 0 ? TimeCategory::BUS : TimeCategory::RETRY,
+                             monotonicNowNs() - begin);
+            }
+            if (rc == 0) {
+                last_retries = attempt;
+                return 0;
+            }
+
+            bool nak = isNAK(-rc);
+            if (nak) entry.naks++;
+            else if (rc == -ETIMEDOUT) entry.timeouts++;
+            else entry.other_errors++;
+
+            // CONTINUE skips NAKing devices without spending retries on them
+            if (attempt >= max_retries || (nak && error_action == ErrorAction::CONTINUE)) {
+                entry.failures++;
+                last_retries = attempt;
+                return rc;
+            }
+
+            entry.retries++;
+            uint64_t backoff_start = latency ? monotonicNowNs() : 0;
+            sleepForUs(backoffUs(attempt));
+            if (latency) {
+                latency->add(TimeCategory::RETRY, monotonicNowNs() - backoff_start);
+            }
+        }
+    }
+
+    // Print counters for every address that saw an error
+    void printStats(std::ostream& out) const;
+    bool hasErrors() const;
+
+private:
+    uint64_t backoffUs(int attempt);
+
+    static constexpr uint64_t MAX_BACKOFF_US = 1000000;
+
+    int retry_count;
+    ErrorAction error_action;
+    BackoffPolicy policy;
+    uint32_t base_backoff_us;
+    int last_retries;
+    LatencyStats* latency = nullptr;
+    std::minstd_rand rng;
+    std::array<AddressErrorStats, 128> stats;
+};
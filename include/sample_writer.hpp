@@ -0,0 +1,85 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <thread>
+#include <vector>
+
+// Output format of sampled frames
+enum class SampleFormat {
+    CSV,       // timestamp_ns,sequence,device,hex bytes
+    BINARY     // Packed records, see SampleWriter::writeBinaryRecord
+};
+
+// Single-producer/single-consumer ring of fixed-size frame slots. All
+// storage is allocated up front; push() and pop() never allocate or block.
+class SampleRing {
+public:
+    struct Slot {
+        uint64_t timestamp_ns;
+        uint32_t sequence;
+        uint16_t device;
+        uint16_t length;
+        uint8_t* data;
+    };
+
+    SampleRing(size_t capacity, size_t frame_size);
+
+    // Producer side: returns false if the ring is full
+    bool push(uint64_t timestamp_ns, uint32_t sequence, uint16_t device,
+              const uint8_t* data, uint16_t length);
+    // Consumer side: returns nullptr if empty, release() after use
+    const Slot* peek();
+    void release();
+
+    size_t frameSize() const { return frame_size; }
+
+private:
+    size_t mask;
+    size_t frame_size;
+    std::vector<Slot> slots;
+    std::vector<uint8_t> arena;
+    alignas(64) std::atomic<size_t> head;   // Next slot to write (producer)
+    alignas(64) std::atomic<size_t> tail;   // Next slot to read (consumer)
+};
+
+// Drains a SampleRing to a file on a dedicated thread so the bus thread
+// never waits for disk or stdout
+class SampleWriter {
+public:
+    SampleWriter(const std::string& path, SampleFormat format, size_t ring_frames,
+                 size_t frame_size, const std::vector<std::string>& devices);
+    ~SampleWriter();
+
+    // Called from the bus thread; counts an overrun instead of blocking
+    void submit(uint64_t timestamp_ns, uint16_t device, const uint8_t* data, uint16_t length);
+
+    // Stop the writer thread after the ring has been drained
+    void finish();
+
+    unsigned long captured() const { return sequence; }
+    unsigned long overruns() const { return overrun_count; }
+    unsigned long written() const { return written_count.load(); }
+
+private:
+    void writerLoop();
+    void writeRecord(const SampleRing::Slot& slot);
+    void writeHeader();
+
+    // Writer poll interval while the ring is empty
+    static constexpr uint64_t WRITER_IDLE_US = 1000;
+
+    SampleRing ring;
+    SampleFormat format;
+    std::vector<std::string> device_names;
+    FILE* out;
+    bool owns_file;
+    std::vector<char> line;
+    uint32_t sequence;
+    unsigned long overrun_count;
+    std::atomic<unsigned long> written_count;
+    std::atomic<bool> done;
+    std::thread writer;
+};
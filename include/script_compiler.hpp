@@ -0,0 +1,189 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+#include "error_action.hpp"
+#include "gap_policy.hpp"
+
+// Opcodes of a compiled CSV script
+enum class OpCode : uint8_t {
+    WRITE,
+    WRITE1,
+    WRITE16,
+    READ,
+    READN,
+    READBLOCK,
+    POLL,
+    DELAY,
+    FILE,
+    LOOP,
+    LOOP_EVERY,
+    SAMPLE,
+    ENDLOOP,
+    START_RECORD,
+    STOP_RECORD,
+    PRINT_RECORD,
+    CALIBRATE,
+    SYNC
+};
+
+constexpr size_t OPCODE_COUNT = static_cast<size_t>(OpCode::SYNC) + 1;
+
+// Script keyword of an opcode, for diagnostics and statistics
+const char* opCodeName(OpCode op);
+
+// A single compiled command. All numeric operands are decoded once at
+// compile time so execution never touches the script text again.
+struct Instruction {
+    OpCode op;
+    uint8_t addr = 0;
+    uint8_t reg = 0;
+    uint16_t data = 0;      // WRITE, WRITE1, WRITE16 data, FILE/SYNC EEPROM start offset,
+                            // SAMPLE device name index into Program::strings
+    int32_t arg0 = 0;       // DELAY us, LOOP/LOOP_EVERY/SAMPLE count, START_RECORD size, READN count,
+                            // FILE/SYNC/PRINT_RECORD/CALIBRATE index into Program::strings,
+                            // POLL index into Program::polls
+    int32_t arg1 = 0;       // LOOP_EVERY/SAMPLE period us,
+                            // FILE/SYNC EEPROM geometry index + 1 (0 = plain FILE)
+    uint32_t jump = 0;      // LOOP/LOOP_EVERY/SAMPLE: index of matching ENDLOOP, ENDLOOP: index of loop
+    int line = 0;           // Source line number for error reporting
+};
+
+// One register condition of a POLL: (value & mask) == expected
+struct PollCondition {
+    uint8_t addr;
+    uint8_t reg;
+    uint8_t mask;
+    uint8_t expected;
+};
+
+// Read schedule and conditions of a POLL, POLL_ANY or POLL_ALL. The first
+// read happens after the hold-off; the interval starts at min_interval_us
+// and doubles after every unsatisfied read up to max_interval_us.
+struct PollSpec {
+    static constexpr size_t MAX_CONDITIONS = 8;
+
+    // Inline storage, so compiling a POLL does not allocate
+    std::array<PollCondition, MAX_CONDITIONS> conditions;
+    size_t condition_count = 0;
+    bool any = false;           // POLL_ANY: one met condition ends the wait
+    uint32_t timeout_us = 0;
+    uint32_t holdoff_us = 0;
+    uint32_t min_interval_us = 0;
+    uint32_t max_interval_us = 0;
+};
+
+// Compiled script: a flat instruction vector where loop bodies are
+// represented as jump ranges, plus a table for string operands.
+struct Program {
+    std::vector<Instruction> code;
+    std::vector<std::string> strings;
+    std::vector<std::pair<uint8_t, DeviceTiming>> timings;  // TIMING declarations
+    std::vector<PollSpec> polls;
+    std::string source;     // Path of the compiled CSV file
+};
+
+class ScriptCompiler {
+public:
+    ScriptCompiler(bool verbose_mode = false, ErrorAction action = ErrorAction::STOP);
+
+    // Compile a CSV file into an executable program. The file is mapped
+    // and tokenized in place, so lines cost no heap allocations. INCLUDEd
+    // files and SUB definitions are cached for the lifetime of the compiler.
+    Program compileFile(const std::string& filename);
+    // Compile script text; source is used for error messages and relative paths
+    Program compileText(std::string_view text, const std::string& source);
+
+    // Position of an incremental compilation
+    struct State {
+        int line_number = 0;
+        bool header_skipped = false;
+        std::vector<size_t> open_loops;     // Indices of unclosed LOOP/SAMPLE in the program
+        std::string open_sub;               // SUB whose body is being recorded
+
+        // No LOOP or SAMPLE block is open, so the program can be executed
+        bool atTopLevel() const { return open_loops.empty(); }
+    };
+
+    // Compile the next line (without its newline) into program. Errors are
+    // reported with the line number and rethrown under ErrorAction::STOP.
+    void compileLine(std::string_view line, State& state, Program& program);
+    // End of input: throws if a block or SUB is still open
+    void finish(const State& state, const Program& program);
+
+    // Strict operand decoding: the whole field must be a number in
+    // [min, max], otherwise "Invalid <what>" / "<what> out of range"
+    static int64_t parseHex(std::string_view field, int64_t min, int64_t max, const char* what);
+    static int64_t parseInt(std::string_view field, int64_t min, int64_t max, const char* what);
+    static double parseReal(std::string_view field, const char* what);
+    // Duration in microseconds: a number with a us, ms or s suffix, bare numbers are ms
+    static uint32_t parseDuration(std::string_view field, const char* what);
+    static uint8_t parseAddress(std::string_view field);
+    static std::string_view trim(std::string_view str);
+
+private:
+    // Fields of one line as views into the script text. Lines with more
+    // fields than any command takes report MAX_TOKENS + 1 and fail the
+    // format checks.
+    class Tokens {
+    public:
+        static constexpr size_t MAX_TOKENS = 12;
+
+        void clear() { count = 0; }
+        void push(std::string_view token) {
+            if (count < MAX_TOKENS) tokens[count] = token;
+            if (count <= MAX_TOKENS) count++;
+        }
+        size_t size() const { return count; }
+        bool empty() const { return count == 0; }
+        std::string_view operator[](size_t i) const { return tokens[i]; }
+
+    private:
+        std::string_view tokens[MAX_TOKENS];
+        size_t count = 0;
+    };
+
+    // SUB,name,params... body, recorded as text and compiled per CALL
+    // argument list
+    struct Subroutine {
+        std::vector<std::string> params;
+        std::vector<std::pair<int, std::string>> lines;    // Source line number, text
+        std::string source;                                 // File the SUB was defined in
+    };
+
+    // Compile one tokenized line and append it to the program
+    void compileTokens(const Tokens& tokens, State& state, Program& program);
+    uint32_t addString(Program& program, std::string_view str);
+
+    // POLL operands from a timeout, "min[..max]" interval and hold-off field
+    static PollSpec parsePollTiming(std::string_view timeout, std::string_view interval,
+                                    std::string_view holdoff);
+    // Replace a $param token with the matching argument of the CALL being expanded
+    std::string_view substitute(std::string_view token) const;
+    void defineSub(const Tokens& tokens, State& state, const Program& program);
+    // Compiled body of a SUB for one argument list, cached per arguments
+    const Program& expandCall(const Tokens& tokens);
+    // Compiled INCLUDE file, cached per canonical path
+    const Program& include(std::string_view path, const Program& program);
+    // Append a compiled fragment; its instructions report the INCLUDE/CALL line
+    void splice(const Program& fragment, int line, Program& program);
+
+
+    static constexpr int32_t MAX_DELAY_US = INT32_MAX;
+
+    bool verbose;
+    ErrorAction error_action;
+    std::unordered_map<std::string, Subroutine> subroutines;
+    std::unordered_map<std::string, Program> call_cache;       // name + arguments
+    std::unordered_map<std::string, Program> include_cache;    // Canonical path
+    std::vector<std::string> include_stack;                     // For cycle detection
+    std::vector<std::string> call_stack;                        // For recursion detection
+    const Subroutine* binding = nullptr;                        // SUB being expanded
+    const Tokens* binding_args = nullptr;                       // Its CALL line
+};
@@ -0,0 +1,56 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include "error_action.hpp"
+#include "script_compiler.hpp"
+
+// Compiles a script read from a pipe (stdin, FIFO) on a parser thread and
+// hands it to the executing thread in blocks through a bounded queue, so
+// parsing overlaps bus I/O and memory stays bounded for endless input.
+// Blocks are self-contained programs that start and end at top level: a
+// LOOP or SAMPLE block is only handed over once its ENDLOOP was read.
+class ScriptStream {
+public:
+    // "-" reads stdin; other paths are opened and read sequentially
+    ScriptStream(const std::string& path, bool verbose, ErrorAction action);
+    ~ScriptStream();
+    ScriptStream(const ScriptStream&) = delete;
+    ScriptStream& operator=(const ScriptStream&) = delete;
+
+    // Next compiled block, waiting for the parser if necessary. Returns
+    // nullptr at the end of input and rethrows parse errors there.
+    std::unique_ptr<Program> next();
+
+private:
+    void parserLoop();
+    // Queue the current block and start a new one; false once cancelled
+    bool flush(std::unique_ptr<Program>& block);
+    // Wait until fd is readable; false once cancelled
+    bool waitReadable();
+
+    static constexpr size_t QUEUE_DEPTH = 16;               // Blocks in flight
+    static constexpr size_t MAX_BLOCK_INSTRUCTIONS = 256;   // Top-level commands per block
+    static constexpr size_t MAX_LOOP_INSTRUCTIONS = 65536;  // Buffered body of an open LOOP
+    static constexpr size_t READ_CHUNK = 64 * 1024;
+    static constexpr int CANCEL_CHECK_MS = 100;
+
+    std::string source;
+    int fd;
+    bool owns_fd;
+    ScriptCompiler compiler;
+    std::mutex mutex;                   // Guards queue, done and error
+    std::deque<std::unique_ptr<Program>> queue;     // At most QUEUE_DEPTH blocks
+    std::condition_variable readable;   // A block was queued or the parser finished
+    std::condition_variable writable;   // A block was taken or the stream is cancelled
+    bool done;
+    std::exception_ptr error;           // Parse error, set together with done
+    std::atomic<bool> cancelled;        // Also polled by the parser between reads
+    std::thread parser;
+};
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include "latency_histogram.hpp"
+
+// All timing is based on absolute CLOCK_MONOTONIC deadlines in nanoseconds,
+// so sleep overshoot does not accumulate across consecutive waits.
+
+// Current CLOCK_MONOTONIC time in nanoseconds
+uint64_t monotonicNowNs();
+
+// Sleep until an absolute CLOCK_MONOTONIC deadline (returns at once if passed)
+void sleepUntilNs(uint64_t deadline_ns);
+
+// Sleep for a relative duration in microseconds
+void sleepForUs(uint64_t duration_us);
+
+// Collects achieved periods of a periodic loop and reports their jitter.
+// Storage is fixed, so arbitrarily long loops neither allocate nor grow.
+class PeriodStats {
+public:
+    void add(uint64_t period_ns, uint64_t target_period_ns);
+    void addOverrun() { overruns++; }
+    void print(std::ostream& out, uint64_t target_period_us) const;
+
+private:
+    LatencyHistogram jitter;                // |achieved - target| per period
+    uint64_t min_ns = UINT64_MAX;           // Achieved periods
+    uint64_t max_ns = 0;
+    uint64_t total_ns = 0;
+    unsigned long overruns = 0;             // Iterations that started late
+};
+
+// Outcome of the waits of one POLL instruction, for tuning its hold-off
+// and interval
+class PollStats {
+public:
+    void add(uint64_t wait_ns, unsigned reads, bool satisfied);
+    void print(std::ostream& out) const;
+
+private:
+    unsigned long waits = 0;
+    unsigned long timeouts = 0;
+    uint64_t total_reads = 0;
+    unsigned max_reads = 0;
+    uint64_t min_ns = UINT64_MAX;           // Time to satisfy, over met waits
+    uint64_t max_ns = 0;
+    uint64_t total_ns = 0;
+};
@@ -0,0 +1,7 @@
+#pragma once
+
+// Enumeration to define how register reads are issued on the bus
+enum class TransferMode {
+    RDWR,      // Register write and data read in one I2C_RDWR ioctl (repeated start)
+    SPLIT      // I2C_SLAVE + write() + read(), with a STOP between write and read
+};
@@ -0,0 +1,63 @@
+#include "atomic_file.hpp"
+#include <cerrno>
+#include <filesystem>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+static void createParent(const std::string& path) {
+    std::error_code ec;
+    std::filesystem::path file(path);
+    if (file.has_parent_path()) {
+        std::filesystem::create_directories(file.parent_path(), ec);
+    }
+}
+
+int replaceFile(const std::string& path, const std::string& content) {
+    createParent(path);
+
+    std::string tmp = path + ".XXXXXX";
+    int fd = mkostemp(&tmp[0], O_CLOEXEC);
+    if (fd < 0) {
+        return -errno;
+    }
+
+    // mkstemp creates the file 0600; cache files are readable like any other
+    int rc = fchmod(fd, 0644) < 0 ? -errno : 0;
+    size_t written = 0;
+    while (rc == 0 && written < content.size()) {
+        ssize_t n = write(fd, content.data() + written, content.size() - written);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            rc = -errno;
+        } else {
+            written += n;
+        }
+    }
+    if (close(fd) < 0 && rc == 0) {
+        rc = -errno;
+    }
+    if (rc == 0 && rename(tmp.c_str(), path.c_str()) < 0) {
+        rc = -errno;
+    }
+    if (rc < 0) {
+        unlink(tmp.c_str());
+    }
+    return rc;
+}
+
+FileLock::FileLock(const std::string& path) {
+    createParent(path);
+    std::string lock_path = path + ".lock";
+    fd = open(lock_path.c_str(), O_RDWR | O_CREAT | O_CLOEXEC, 0644);
+    if (fd < 0) return;
+    while (flock(fd, LOCK_EX) < 0 && errno == EINTR) {
+    }
+}
+
+FileLock::~FileLock() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
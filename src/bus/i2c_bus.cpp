@@ -0,0 +1,64 @@
+#include "bus/i2c_bus.hpp"
+#include "bus/i2c_dev_bus.hpp"
+#include "bus/smbus_bus.hpp"
+#include "bus/sim_bus.hpp"
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+#include <stdexcept>
+#include <iostream>
+
+bool probeByRead(uint8_t addr) {
+    return (addr >= 0x30 && addr <= 0x37) || (addr >= 0x50 && addr <= 0x5F);
+}
+
+std::unique_ptr<I2CBus> createBus(const std::string& device, const BusOptions& options,
+                                  bool verbose) {
+    if (device.compare(0, 4, "sim:") == 0) {
+        std::unique_ptr<I2CBus> bus = createSimBus(device.substr(4), verbose);
+        bus->setDevice(device);
+        return bus;
+    }
+
+    int fd = open(device.c_str(), O_RDWR);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open I2C device: " + device);
+    }
+
+    unsigned long funcs = 0;
+    if (ioctl(fd, I2C_FUNCS, &funcs) < 0) {
+        funcs = 0;
+    }
+
+    BusType type = options.type;
+    if (type == BusType::AUTO) {
+        type = (funcs & I2C_FUNC_I2C) ? BusType::I2C : BusType::SMBUS;
+        if (type == BusType::I2C && options.pec) {
+            // PEC only applies to SMBus protocol transfers
+            type = BusType::SMBUS;
+        }
+    }
+
+    std::unique_ptr<I2CBus> bus;
+    if (type == BusType::SMBUS) {
+        if (!(funcs & I2C_FUNC_SMBUS_BYTE_DATA)) {
+            close(fd);
+            throw std::runtime_error("Adapter supports neither plain I2C nor SMBus byte data: " + device);
+        }
+        bus = std::make_unique<SMBusBus>(fd, funcs, options.pec);
+    } else {
+        if (options.pec) {
+            std::cerr << "PEC requires the SMBus backend, ignoring --pec\n";
+        }
+        bus = std::make_unique<I2CDevBus>(fd, funcs, options.transfer_mode);
+    }
+
+    bus->setDevice(device);
+
+    if (verbose) {
+        std::cout << "Using " << bus->name() << " backend on " << device
+                  << " (I2C_FUNCS 0x" << std::hex << funcs << std::dec << ")\n";
+    }
+    return bus;
+}
@@ -0,0 +1,125 @@
+#include "bus/i2c_dev_bus.hpp"
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+I2CDevBus::I2CDevBus(int fd_, unsigned long funcs_, TransferMode mode)
+    : I2CDevFdBus(fd_, funcs_), rdwr_supported((funcs_ & I2C_FUNC_I2C) != 0), transfer_mode(mode) {
+
+    if (transfer_mode == TransferMode::RDWR && !rdwr_supported) {
+        std::cerr << "Adapter does not support I2C_RDWR, using split transfers\n";
+        transfer_mode = TransferMode::SPLIT;
+    }
+}
+
+int I2CDevBus::readRegister(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+    if (transfer_mode == TransferMode::RDWR) {
+        // Register pointer write and data read joined by a repeated start
+        struct i2c_msg msgs[2];
+        msgs[0].addr = addr;
+        msgs[0].flags = 0;
+        msgs[0].len = 1;
+        msgs[0].buf = &reg;
+        msgs[1].addr = addr;
+        msgs[1].flags = I2C_M_RD;
+        msgs[1].len = len;
+        msgs[1].buf = data;
+        return transfer(msgs, 2);
+    }
+
+    int rc = selectSlave(addr);
+    if (rc < 0) return rc;
+
+    ssize_t n = write(fd, &reg, 1);
+    if (n != 1) {
+        invalidateSlave();
+        return n < 0 ? -errno : -EIO;
+    }
+    n = read(fd, data, len);
+    if (n != len) {
+        invalidateSlave();
+        return n < 0 ? -errno : -EIO;
+    }
+    return 0;
+}
+
+int I2CDevBus::writeRegister(uint8_t addr, uint8_t reg, const uint8_t* data, uint16_t len) {
+    uint8_t small[16];
+    std::vector<uint8_t> large;
+    uint8_t* buf = small;
+    if (len + 1u > sizeof(small)) {
+        large.resize(len + 1);
+        buf = large.data();
+    }
+    buf[0] = reg;
+    std::copy(data, data + len, buf + 1);
+    return writeBytes(addr, buf, len + 1);
+}
+
+int I2CDevBus::writeBytes(uint8_t addr, const uint8_t* data, uint16_t len) {
+    int rc = selectSlave(addr);
+    if (rc < 0) return rc;
+
+    ssize_t n = write(fd, data, len);
+    if (n != len) {
+        invalidateSlave();
+        return n < 0 ? -errno : -EIO;
+    }
+    return 0;
+}
+
+int I2CDevBus::readBlockData(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t* len) {
+    // Emulate an SMBus block read: fetch the count byte and the largest
+    // possible block, then keep only what the device announced
+    uint8_t buf[1 + I2C_SMBUS_BLOCK_MAX];
+    int rc = readRegister(addr, reg, buf, sizeof(buf));
+    if (rc < 0) return rc;
+
+    if (buf[0] == 0 || buf[0] > I2C_SMBUS_BLOCK_MAX) {
+        return -EPROTO;
+    }
+    *len = buf[0];
+    std::copy(buf + 1, buf + 1 + buf[0], data);
+    return 0;
+}
+
+int I2CDevBus::probe(uint8_t addr) {
+    // I2C_SLAVE fails with EBUSY on addresses claimed by a kernel driver
+    int rc = selectSlave(addr);
+    if (rc < 0) return rc;
+
+    if (!probeByRead(addr) && (funcs & I2C_FUNC_SMBUS_QUICK)) {
+        struct i2c_smbus_ioctl_data args;
+        args.read_write = I2C_SMBUS_WRITE;
+        args.command = 0;
+        args.size = I2C_SMBUS_QUICK;
+        args.data = nullptr;
+        return ioctl(fd, I2C_SMBUS, &args) < 0 ? -errno : 0;
+    }
+
+    uint8_t byte;
+    ssize_t n = read(fd, &byte, 1);
+    if (n != 1) {
+        return n < 0 ? -errno : -EIO;
+    }
+    return 0;
+}
+
+int I2CDevBus::transfer(struct i2c_msg* msgs, size_t count) {
+    struct i2c_rdwr_ioctl_data xfer;
+    xfer.msgs = msgs;
+    xfer.nmsgs = count;
+
+    int n = ioctl(fd, I2C_RDWR, &xfer);
+    if (n != static_cast<int>(count)) {
+        return n < 0 ? -errno : -EIO;
+    }
+    return 0;
+}
+
+size_t I2CDevBus::maxTransferMessages() const {
+    return rdwr_supported ? I2C_RDWR_IOCTL_MAX_MSGS : 0;
+}
@@ -0,0 +1,45 @@
+#include "bus/i2c_dev_fd_bus.hpp"
+#include <cerrno>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+
+I2CDevFdBus::I2CDevFdBus(int fd_, unsigned long funcs_)
+    : fd(fd_), funcs(funcs_), current_slave(-1), slave_ioctls_issued(0), slave_ioctls_skipped(0) {}
+
+I2CDevFdBus::~I2CDevFdBus() {
+    if (fd >= 0) {
+        close(fd);
+    }
+}
+
+int I2CDevFdBus::selectSlave(uint8_t addr) {
+    if (current_slave == addr) {
+        slave_ioctls_skipped++;
+        return 0;
+    }
+
+    slave_ioctls_issued++;
+    if (ioctl(fd, I2C_SLAVE, addr) < 0) {
+        current_slave = -1;
+        return -errno;
+    }
+    current_slave = addr;
+    return 0;
+}
+
+int I2CDevFdBus::configureAdapter(int retries, int timeout_ms) {
+    if (retries >= 0 && ioctl(fd, I2C_RETRIES, retries) < 0) {
+        return -errno;
+    }
+    // I2C_TIMEOUT is expressed in units of 10 ms
+    if (timeout_ms >= 0 && ioctl(fd, I2C_TIMEOUT, (timeout_ms + 9) / 10) < 0) {
+        return -errno;
+    }
+    return 0;
+}
+
+void I2CDevFdBus::printStats(std::ostream& out) const {
+    out << "I2C_SLAVE ioctls: " << slave_ioctls_issued << " issued, "
+        << slave_ioctls_skipped << " avoided\n";
+}
@@ -0,0 +1,247 @@
+#include "bus/sim_bus.hpp"
+#include "timing.hpp"
+#include <linux/i2c-dev.h>
+#include <algorithm>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+
+SimBus::SimBus(const SimTiming& timing_)
+    : timing(timing_), rng(timing_.seed), chance(0.0, 1.0), bus_free_at(0),
+      transactions(0), bytes(0), naks_injected(0), naks_absent(0), modeled_ns(0) {
+    slaves.fill(nullptr);
+}
+
+bool SimBus::attach(uint8_t addr, std::unique_ptr<SimDevice> device) {
+    uint8_t span = device->addressSpan();
+    if ((addr & (span - 1)) != 0 || addr + span > 0x80) {
+        return false;
+    }
+    for (uint8_t i = 0; i < span; i++) {
+        if (slaves[addr + i]) return false;
+    }
+    for (uint8_t i = 0; i < span; i++) {
+        slaves[addr + i] = device.get();
+    }
+    devices.push_back(std::move(device));
+    return true;
+}
+
+void SimBus::charge(const struct i2c_msg* msgs, size_t count) {
+    // Start, address byte + ACK and 9 clocks per data byte for every
+    // message, plus the final stop
+    uint64_t bits = 1;
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        bits += 1 + 9 + 9ull * msgs[i].len;
+        len += msgs[i].len;
+    }
+    uint64_t cost = bits * 1000000000ull / timing.clock_hz +
+                    len * static_cast<uint64_t>(timing.byte_cost_ns) + timing.transaction_cost_ns;
+
+    transactions++;
+    bytes += len;
+    modeled_ns += cost;
+
+    if (timing.realtime) {
+        bus_free_at = std::max(bus_free_at, monotonicNowNs()) + cost;
+        sleepUntilNs(bus_free_at);
+    }
+}
+
+int SimBus::execute(struct i2c_msg* msgs, size_t count) {
+    charge(msgs, count);
+
+    if (timing.nak_rate > 0.0 && chance(rng) < timing.nak_rate) {
+        naks_injected++;
+        return -ENXIO;
+    }
+
+    for (size_t i = 0; i < count; i++) {
+        SimDevice* device = slaves[msgs[i].addr & 0x7F];
+        if (!device || device->busy()) {
+            naks_absent++;
+            return -ENXIO;
+        }
+        if (msgs[i].len == 0) {
+            // Zero-length message: the address ACK is all there is
+            continue;
+        }
+        if (msgs[i].flags & I2C_M_RD) {
+            device->read(msgs[i].addr, msgs[i].buf, msgs[i].len);
+        } else {
+            device->write(msgs[i].addr, msgs[i].buf, msgs[i].len);
+        }
+    }
+    return 0;
+}
+
+int SimBus::readRegister(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+    struct i2c_msg msgs[2];
+    msgs[0].addr = addr;
+    msgs[0].flags = 0;
+    msgs[0].len = 1;
+    msgs[0].buf = &reg;
+    msgs[1].addr = addr;
+    msgs[1].flags = I2C_M_RD;
+    msgs[1].len = len;
+    msgs[1].buf = data;
+    return execute(msgs, 2);
+}
+
+int SimBus::writeRegister(uint8_t addr, uint8_t reg, const uint8_t* data, uint16_t len) {
+    if (len + 1u > MAX_WRITE_LENGTH) return -EMSGSIZE;
+    std::vector<uint8_t> buf(1 + len);
+    buf[0] = reg;
+    std::copy(data, data + len, buf.begin() + 1);
+    return writeBytes(addr, buf.data(), buf.size());
+}
+
+int SimBus::writeBytes(uint8_t addr, const uint8_t* data, uint16_t len) {
+    if (len > MAX_WRITE_LENGTH) return -EMSGSIZE;
+    struct i2c_msg msg;
+    msg.addr = addr;
+    msg.flags = 0;
+    msg.len = len;
+    msg.buf = const_cast<uint8_t*>(data);
+    return execute(&msg, 1);
+}
+
+int SimBus::readBlockData(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t* len) {
+    // Same emulation as the i2c backend: the first byte is the count
+    uint8_t buf[1 + I2C_SMBUS_BLOCK_MAX];
+    int rc = readRegister(addr, reg, buf, sizeof(buf));
+    if (rc < 0) return rc;
+
+    if (buf[0] == 0 || buf[0] > I2C_SMBUS_BLOCK_MAX) {
+        return -EPROTO;
+    }
+    *len = buf[0];
+    std::copy(buf + 1, buf + 1 + buf[0], data);
+    return 0;
+}
+
+int SimBus::probe(uint8_t addr) {
+    uint8_t byte = 0;
+    struct i2c_msg msg;
+    msg.addr = addr;
+    msg.flags = probeByRead(addr) ? I2C_M_RD : 0;
+    msg.len = probeByRead(addr) ? 1 : 0;
+    msg.buf = &byte;
+    return execute(&msg, 1);
+}
+
+int SimBus::transfer(struct i2c_msg* msgs, size_t count) {
+    if (count > I2C_RDWR_IOCTL_MAX_MSGS) return -EINVAL;
+    return execute(msgs, count);
+}
+
+size_t SimBus::maxTransferMessages() const {
+    return I2C_RDWR_IOCTL_MAX_MSGS;
+}
+
+int SimBus::configureAdapter(int retries, int timeout_ms) {
+    // Nothing to configure, accept so --kernel-retries behaves as on hardware
+    (void)retries;
+    (void)timeout_ms;
+    return 0;
+}
+
+void SimBus::printStats(std::ostream& out) const {
+    out << "Simulated bus: " << transactions << " transactions, " << bytes << " bytes, "
+        << naks_injected << " injected NAKs, " << naks_absent << " absent/busy NAKs, "
+        << std::fixed << std::setprecision(3) << modeled_ns / 1e6 << " ms modeled bus time\n";
+    out.unsetf(std::ios::floatfield);
+}
+
+static void attachDevice(SimBus& bus, const std::string& type, uint8_t addr,
+                         uint32_t write_cycle_us) {
+    std::unique_ptr<SimDevice> device = createSimDevice(type, write_cycle_us);
+    if (!device) {
+        throw std::runtime_error("Unknown simulated device: " + type);
+    }
+    if (!bus.attach(addr, std::move(device))) {
+        std::stringstream ss;
+        ss << "Cannot attach " << type << " at 0x" << std::hex << static_cast<int>(addr);
+        throw std::runtime_error(ss.str());
+    }
+}
+
+std::unique_ptr<I2CBus> createSimBus(const std::string& config, bool verbose) {
+    SimTiming timing;
+    std::vector<std::pair<std::string, uint8_t>> attached;
+
+    if (config.empty()) {
+        attached = {
+            {"VEML7700", 0x10}, {"BH1750", 0x23}, {"PCF8574", 0x38}, {"ADS1015", 0x48},
+            {"24C02", 0x50}, {"DS3231", 0x68}, {"BMP280", 0x76}
+        };
+    } else {
+        std::ifstream file(config);
+        if (!file.is_open()) {
+            throw std::runtime_error("Failed to open simulator config: " + config);
+        }
+
+        std::string line;
+        int line_number = 0;
+        while (std::getline(file, line)) {
+            line_number++;
+            size_t first = line.find_first_not_of(" \t\r\n");
+            if (first == std::string::npos || line[first] == '#') continue;
+
+            std::stringstream ss(line);
+            std::string token;
+            std::vector<std::string> tokens;
+            while (std::getline(ss, token, ',')) {
+                size_t b = token.find_first_not_of(" \t\r");
+                size_t e = token.find_last_not_of(" \t\r");
+                tokens.push_back(b == std::string::npos ? "" : token.substr(b, e - b + 1));
+            }
+
+            try {
+                const std::string& key = tokens[0];
+                if (key == "DEVICE" && tokens.size() == 3) {
+                    attached.emplace_back(tokens[1], std::stoi(tokens[2], nullptr, 16));
+                } else if (tokens.size() != 2) {
+                    throw std::runtime_error("expected KEY,value or DEVICE,type,addr");
+                } else if (key == "CLOCK") {
+                    timing.clock_hz = std::stoul(tokens[1]);
+                    if (timing.clock_hz == 0) throw std::runtime_error("CLOCK must be positive");
+                } else if (key == "BYTE_NS") {
+                    timing.byte_cost_ns = std::stoul(tokens[1]);
+                } else if (key == "TRANSACTION_NS") {
+                    timing.transaction_cost_ns = std::stoul(tokens[1]);
+                } else if (key == "NAK_RATE") {
+                    timing.nak_rate = std::stod(tokens[1]);
+                    if (timing.nak_rate < 0.0 || timing.nak_rate > 1.0) {
+                        throw std::runtime_error("NAK_RATE must be within 0..1");
+                    }
+                } else if (key == "REALTIME") {
+                    timing.realtime = std::stoi(tokens[1]) != 0;
+                } else if (key == "SEED") {
+                    timing.seed = std::stoul(tokens[1]);
+                } else if (key == "WRITE_CYCLE_US") {
+                    timing.write_cycle_us = std::stoul(tokens[1]);
+                } else {
+                    throw std::runtime_error("unknown key " + key);
+                }
+            } catch (const std::exception& e) {
+                throw std::runtime_error(config + ":" + std::to_string(line_number) + ": " + e.what());
+            }
+        }
+    }
+
+    auto bus = std::make_unique<SimBus>(timing);
+    for (const auto& device : attached) {
+        attachDevice(*bus, device.first, device.second, timing.write_cycle_us);
+    }
+
+    if (verbose) {
+        std::cout << "Using simulated bus: " << attached.size() << " device(s), "
+                  << timing.clock_hz << " Hz, NAK rate " << timing.nak_rate
+                  << (timing.realtime ? "" : ", not realtime") << "\n";
+    }
+    return bus;
+}
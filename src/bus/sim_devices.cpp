@@ -0,0 +1,318 @@
+#include "bus/sim_devices.hpp"
+#include "eeprom_geometry.hpp"
+#include "timing.hpp"
+#include <algorithm>
+#include <array>
+#include <ctime>
+#include <vector>
+
+namespace {
+
+// 8-bit register file with an auto-incrementing pointer set by the first
+// byte of every write
+class RegisterMapDevice : public SimDevice {
+public:
+    void write(uint8_t addr, const uint8_t* data, size_t len) override {
+        (void)addr;
+        if (len == 0) return;
+        pointer = data[0];
+        for (size_t i = 1; i < len; i++) {
+            writeRegister(pointer, data[i]);
+            pointer++;
+        }
+    }
+
+    void read(uint8_t addr, uint8_t* data, size_t len) override {
+        (void)addr;
+        for (size_t i = 0; i < len; i++) {
+            data[i] = readRegister(pointer);
+            pointer++;
+        }
+    }
+
+protected:
+    virtual void writeRegister(uint8_t reg, uint8_t value) { regs[reg] = value; }
+    virtual uint8_t readRegister(uint8_t reg) { return regs[reg]; }
+
+    std::array<uint8_t, 256> regs{};
+    uint8_t pointer = 0;
+};
+
+// BMP280 with the datasheet example trim values and readings (25.08 degC,
+// 1006.53 hPa once compensated)
+class BMP280Model : public RegisterMapDevice {
+public:
+    BMP280Model() { reset(); }
+
+protected:
+    void writeRegister(uint8_t reg, uint8_t value) override {
+        if (reg == 0xE0) {
+            if (value == 0xB6) reset();
+            return;
+        }
+        if (reg == 0xF4 || reg == 0xF5) {
+            regs[reg] = value;
+        }
+    }
+
+private:
+    void reset() {
+        static const uint8_t trim[24] = {
+            0x70, 0x6B, 0x43, 0x67, 0x18, 0xFC, 0x7D, 0x8E, 0x43, 0xD6, 0xD0, 0x0B,
+            0x27, 0x0B, 0x8C, 0x00, 0xF9, 0xFF, 0x8C, 0x3C, 0xF8, 0xC6, 0x70, 0x17
+        };
+        regs.fill(0);
+        std::copy(trim, trim + sizeof(trim), regs.begin() + 0x88);
+        regs[0xD0] = 0x58;      // Chip ID
+        // Pressure 0xF7-0xF9 (adc_P = 415148), temperature 0xFA-0xFC (adc_T = 519888)
+        const uint8_t data[6] = {0x65, 0x5A, 0xC0, 0x7E, 0xED, 0x00};
+        std::copy(data, data + sizeof(data), regs.begin() + 0xF7);
+    }
+};
+
+// DS3231 whose time registers run from the host clock; writing them sets
+// the simulated time
+class DS3231Model : public RegisterMapDevice {
+public:
+    DS3231Model() : base_time(std::time(nullptr)), base_ns(monotonicNowNs()) {
+        regs[0x0E] = 0x1C;      // Control: INTCN, RS2, RS1
+    }
+
+protected:
+    void writeRegister(uint8_t reg, uint8_t value) override {
+        if (reg > 0x12) return;
+        if (reg <= 0x06) {
+            updateTime();
+            regs[reg] = value;
+            base_time = registersToTime();
+            base_ns = monotonicNowNs();
+            return;
+        }
+        regs[reg] = value;
+    }
+
+    uint8_t readRegister(uint8_t reg) override {
+        if (reg <= 0x06) updateTime();
+        return reg <= 0x12 ? regs[reg] : 0;
+    }
+
+private:
+    static uint8_t toBCD(int value) { return ((value / 10) << 4) | (value % 10); }
+    static int fromBCD(uint8_t bcd) { return (bcd >> 4) * 10 + (bcd & 0x0F); }
+
+    void updateTime() {
+        time_t now = base_time + static_cast<time_t>((monotonicNowNs() - base_ns) / 1000000000ull);
+        struct tm tm;
+        gmtime_r(&now, &tm);
+        regs[0x00] = toBCD(tm.tm_sec);
+        regs[0x01] = toBCD(tm.tm_min);
+        regs[0x02] = toBCD(tm.tm_hour);     // 24-hour mode
+        regs[0x03] = tm.tm_wday + 1;
+        regs[0x04] = toBCD(tm.tm_mday);
+        regs[0x05] = toBCD(tm.tm_mon + 1);
+        regs[0x06] = toBCD(tm.tm_year % 100);
+    }
+
+    time_t registersToTime() const {
+        struct tm tm = {};
+        tm.tm_sec = fromBCD(regs[0x00] & 0x7F);
+        tm.tm_min = fromBCD(regs[0x01] & 0x7F);
+        tm.tm_hour = fromBCD(regs[0x02] & 0x3F);
+        tm.tm_mday = fromBCD(regs[0x04]);
+        tm.tm_mon = fromBCD(regs[0x05] & 0x1F) - 1;
+        tm.tm_year = 100 + fromBCD(regs[0x06]);
+        return timegm(&tm);
+    }
+
+    time_t base_time;
+    uint64_t base_ns;
+};
+
+// BH1750 takes opcode writes and answers every read with the latest result
+class BH1750Model : public SimDevice {
+public:
+    void write(uint8_t addr, const uint8_t* data, size_t len) override {
+        (void)addr;
+        for (size_t i = 0; i < len; i++) {
+            switch (data[i]) {
+                case 0x00: powered = false; break;
+                case 0x01: powered = true; break;
+                case 0x07: if (powered) result = 0; break;
+                default:
+                    // A measurement command; power-down keeps the last result
+                    if (powered) result = 600;      // 500 lux in high resolution mode
+                    break;
+            }
+        }
+    }
+
+    void read(uint8_t addr, uint8_t* data, size_t len) override {
+        (void)addr;
+        uint16_t value = result;
+        for (size_t i = 0; i < len; i++) {
+            data[i] = (i % 2 == 0) ? (value >> 8) : (value & 0xFF);
+        }
+    }
+
+private:
+    bool powered = false;
+    uint16_t result = 0;
+};
+
+// 16-bit register file: a command/pointer byte followed by 16-bit words
+class WordRegisterDevice : public SimDevice {
+public:
+    explicit WordRegisterDevice(bool big_endian_) : big_endian(big_endian_) {}
+
+    void write(uint8_t addr, const uint8_t* data, size_t len) override {
+        (void)addr;
+        if (len == 0) return;
+        pointer = data[0];
+        if (len >= 3) {
+            uint16_t value = big_endian ? (data[1] << 8) | data[2] : data[1] | (data[2] << 8);
+            writeRegister(pointer, value);
+        }
+    }
+
+    void read(uint8_t addr, uint8_t* data, size_t len) override {
+        (void)addr;
+        uint16_t value = readRegister(pointer);
+        for (size_t i = 0; i < len; i++) {
+            bool high = big_endian ? (i % 2 == 0) : (i % 2 == 1);
+            data[i] = high ? (value >> 8) : (value & 0xFF);
+        }
+    }
+
+protected:
+    virtual void writeRegister(uint8_t reg, uint16_t value) { regs[reg & 0x0F] = value; }
+    virtual uint16_t readRegister(uint8_t reg) { return regs[reg & 0x0F]; }
+
+    std::array<uint16_t, 16> regs{};
+    uint8_t pointer = 0;
+    bool big_endian;
+};
+
+// VEML7700: little-endian words, ALS output 0 while shut down
+class VEML7700Model : public WordRegisterDevice {
+public:
+    VEML7700Model() : WordRegisterDevice(false) {
+        regs[0x00] = 0x0001;    // ALS_SD: shut down after power-up
+        regs[0x07] = 0xC481;    // Device ID
+    }
+
+protected:
+    uint16_t readRegister(uint8_t reg) override {
+        bool shutdown = regs[0x00] & 0x0001;
+        if (reg == 0x04) return shutdown ? 0 : 0x2000;    // ALS
+        if (reg == 0x05) return shutdown ? 0 : 0x3000;    // WHITE
+        return WordRegisterDevice::readRegister(reg);
+    }
+};
+
+// ADS1015: big-endian words, conversion result left-aligned in 16 bits
+class ADS1015Model : public WordRegisterDevice {
+public:
+    ADS1015Model() : WordRegisterDevice(true) {
+        regs[0x01] = 0x8583;    // Config reset value
+        regs[0x02] = 0x8000;    // Lo_thresh
+        regs[0x03] = 0x7FFF;    // Hi_thresh
+    }
+
+protected:
+    void writeRegister(uint8_t reg, uint16_t value) override {
+        if ((reg & 0x03) == 0) return;      // Conversion register is read-only
+        if ((reg & 0x03) == 0x01) {
+            value |= 0x8000;    // OS: single-shot conversions complete at once
+        }
+        regs[reg & 0x03] = value;
+    }
+
+    uint16_t readRegister(uint8_t reg) override {
+        if ((reg & 0x03) == 0) return 500 << 4;   // ~1.0 V at +/-4.096 V full scale
+        return regs[reg & 0x03];
+    }
+};
+
+// 24Cxx EEPROM with page-wrapping writes and a write cycle during which the
+// device NAKs its address
+class EEPROMModel : public SimDevice {
+public:
+    EEPROMModel(const EEPROMGeometry& geometry_, uint32_t write_cycle_us)
+        : geometry(geometry_), memory(geometry_.size, 0xFF), pointer(0),
+          write_cycle_ns(write_cycle_us * 1000ull), busy_until(0) {}
+
+    void write(uint8_t addr, const uint8_t* data, size_t len) override {
+        if (len < geometry.addr_bytes) return;
+
+        size_t word = 0;
+        for (uint8_t i = 0; i < geometry.addr_bytes; i++) {
+            word = (word << 8) | data[i];
+        }
+        word |= static_cast<size_t>(addr & ((1 << geometry.block_bits) - 1)) << 8;
+        pointer = word % memory.size();
+
+        if (len == geometry.addr_bytes) return;
+
+        // Data bytes wrap within the current page
+        size_t page = pointer - pointer % geometry.page_size;
+        size_t offset = pointer % geometry.page_size;
+        for (size_t i = geometry.addr_bytes; i < len; i++) {
+            memory[page + offset] = data[i];
+            offset = (offset + 1) % geometry.page_size;
+        }
+        pointer = page + offset;
+        busy_until = monotonicNowNs() + write_cycle_ns;
+    }
+
+    void read(uint8_t addr, uint8_t* data, size_t len) override {
+        (void)addr;
+        for (size_t i = 0; i < len; i++) {
+            data[i] = memory[pointer];
+            pointer = (pointer + 1) % memory.size();
+        }
+    }
+
+    bool busy() const override { return monotonicNowNs() < busy_until; }
+    uint8_t addressSpan() const override { return 1 << geometry.block_bits; }
+
+private:
+    const EEPROMGeometry& geometry;
+    std::vector<uint8_t> memory;
+    size_t pointer;
+    uint64_t write_cycle_ns;
+    uint64_t busy_until;
+};
+
+// PCF8574 quasi-bidirectional port; inputs float high, so reads return the latch
+class PCF8574Model : public SimDevice {
+public:
+    void write(uint8_t addr, const uint8_t* data, size_t len) override {
+        (void)addr;
+        if (len > 0) latch = data[len - 1];
+    }
+
+    void read(uint8_t addr, uint8_t* data, size_t len) override {
+        (void)addr;
+        std::fill(data, data + len, latch);
+    }
+
+private:
+    uint8_t latch = 0xFF;
+};
+
+} // namespace
+
+std::unique_ptr<SimDevice> createSimDevice(const std::string& type, uint32_t write_cycle_us) {
+    if (type == "BMP280") return std::make_unique<BMP280Model>();
+    if (type == "DS3231") return std::make_unique<DS3231Model>();
+    if (type == "BH1750") return std::make_unique<BH1750Model>();
+    if (type == "VEML7700") return std::make_unique<VEML7700Model>();
+    if (type == "ADS1015") return std::make_unique<ADS1015Model>();
+    if (type == "PCF8574") return std::make_unique<PCF8574Model>();
+
+    int geometry = findEEPROMGeometry(type);
+    if (geometry >= 0) {
+        return std::make_unique<EEPROMModel>(EEPROM_GEOMETRIES[geometry], write_cycle_us);
+    }
+    return nullptr;
+}
@@ -0,0 +1,173 @@
+#include "bus/smbus_bus.hpp"
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <linux/i2c-dev.h>
+#include <algorithm>
+#include <iostream>
+
+SMBusBus::SMBusBus(int fd_, unsigned long funcs_, bool pec_)
+    : I2CDevFdBus(fd_, funcs_), pec(pec_) {
+
+    if (pec) {
+        if (!(funcs & I2C_FUNC_SMBUS_PEC)) {
+            std::cerr << "Adapter does not support SMBus PEC, continuing without it\n";
+            pec = false;
+        } else if (ioctl(fd, I2C_PEC, 1) < 0) {
+            std::cerr << "Failed to enable SMBus PEC, continuing without it\n";
+            pec = false;
+        }
+    }
+}
+
+int SMBusBus::access(uint8_t read_write, uint8_t command, uint32_t size,
+                     union i2c_smbus_data* data) {
+    struct i2c_smbus_ioctl_data args;
+    args.read_write = read_write;
+    args.command = command;
+    args.size = size;
+    args.data = data;
+
+    if (ioctl(fd, I2C_SMBUS, &args) < 0) {
+        return -errno;
+    }
+    return 0;
+}
+
+int SMBusBus::readRegister(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+    int rc = selectSlave(addr);
+    if (rc < 0) return rc;
+
+    union i2c_smbus_data smbus_data;
+
+    if (len == 2 && (funcs & I2C_FUNC_SMBUS_READ_WORD_DATA)) {
+        // SMBus words are transferred low byte first, matching bus order
+        rc = access(I2C_SMBUS_READ, reg, I2C_SMBUS_WORD_DATA, &smbus_data);
+        if (rc < 0) return rc;
+        data[0] = smbus_data.word & 0xFF;
+        data[1] = (smbus_data.word >> 8) & 0xFF;
+        return 0;
+    }
+
+    if (len > 1 && (funcs & I2C_FUNC_SMBUS_READ_I2C_BLOCK)) {
+        uint16_t pos = 0;
+        while (pos < len) {
+            uint8_t chunk = std::min<uint16_t>(len - pos, I2C_SMBUS_BLOCK_MAX);
+            smbus_data.block[0] = chunk;
+            rc = access(I2C_SMBUS_READ, static_cast<uint8_t>(reg + pos),
+                        I2C_SMBUS_I2C_BLOCK_DATA, &smbus_data);
+            if (rc < 0) return rc;
+            if (smbus_data.block[0] != chunk) return -EIO;
+            std::copy(smbus_data.block + 1, smbus_data.block + 1 + chunk, data + pos);
+            pos += chunk;
+        }
+        return 0;
+    }
+
+    if (!(funcs & I2C_FUNC_SMBUS_READ_BYTE_DATA)) {
+        return -EOPNOTSUPP;
+    }
+    for (uint16_t i = 0; i < len; i++) {
+        rc = access(I2C_SMBUS_READ, static_cast<uint8_t>(reg + i), I2C_SMBUS_BYTE_DATA, &smbus_data);
+        if (rc < 0) return rc;
+        data[i] = smbus_data.byte;
+    }
+    return 0;
+}
+
+int SMBusBus::writeRegister(uint8_t addr, uint8_t reg, const uint8_t* data, uint16_t len) {
+    int rc = selectSlave(addr);
+    if (rc < 0) return rc;
+
+    union i2c_smbus_data smbus_data;
+
+    if (len == 2 && (funcs & I2C_FUNC_SMBUS_WRITE_WORD_DATA)) {
+        smbus_data.word = data[0] | (data[1] << 8);
+        return access(I2C_SMBUS_WRITE, reg, I2C_SMBUS_WORD_DATA, &smbus_data);
+    }
+
+    if (len > 1 && (funcs & I2C_FUNC_SMBUS_WRITE_I2C_BLOCK)) {
+        uint16_t pos = 0;
+        while (pos < len) {
+            uint8_t chunk = std::min<uint16_t>(len - pos, I2C_SMBUS_BLOCK_MAX);
+            smbus_data.block[0] = chunk;
+            std::copy(data + pos, data + pos + chunk, smbus_data.block + 1);
+            rc = access(I2C_SMBUS_WRITE, static_cast<uint8_t>(reg + pos),
+                        I2C_SMBUS_I2C_BLOCK_DATA, &smbus_data);
+            if (rc < 0) return rc;
+            pos += chunk;
+        }
+        return 0;
+    }
+
+    // Splitting a multi-byte write into byte writes at reg, reg+1, ... would
+    // report success while word registers (ADS1015 config, VEML7700, INA2xx),
+    // which latch only a complete 16-bit transaction, hold garbage
+    if (len != 1 || !(funcs & I2C_FUNC_SMBUS_WRITE_BYTE_DATA)) {
+        return -EOPNOTSUPP;
+    }
+    smbus_data.byte = data[0];
+    return access(I2C_SMBUS_WRITE, reg, I2C_SMBUS_BYTE_DATA, &smbus_data);
+}
+
+int SMBusBus::writeBytes(uint8_t addr, const uint8_t* data, uint16_t len) {
+    if (len == 0) {
+        int rc = selectSlave(addr);
+        if (rc < 0) return rc;
+        if (!(funcs & I2C_FUNC_SMBUS_QUICK)) return -EOPNOTSUPP;
+        return access(I2C_SMBUS_WRITE, 0, I2C_SMBUS_QUICK, nullptr);
+    }
+
+    if (len == 1) {
+        int rc = selectSlave(addr);
+        if (rc < 0) return rc;
+        if (!(funcs & I2C_FUNC_SMBUS_WRITE_BYTE)) return -EOPNOTSUPP;
+        return access(I2C_SMBUS_WRITE, data[0], I2C_SMBUS_BYTE, nullptr);
+    }
+
+    // The first byte becomes the SMBus command, the rest a single block
+    if (len > maxWriteLength()) {
+        return -EMSGSIZE;
+    }
+    // Three bytes are a register plus a 16-bit word, sent low byte first
+    // as WORD_DATA; anything longer needs an I2C block
+    if (!(funcs & I2C_FUNC_SMBUS_WRITE_I2C_BLOCK) &&
+        (len > 3 || !(funcs & I2C_FUNC_SMBUS_WRITE_WORD_DATA))) {
+        return -EOPNOTSUPP;
+    }
+    return writeRegister(addr, data[0], data + 1, len - 1);
+}
+
+int SMBusBus::readBlockData(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t* len) {
+    int rc = selectSlave(addr);
+    if (rc < 0) return rc;
+    if (!(funcs & I2C_FUNC_SMBUS_READ_BLOCK_DATA)) return -EOPNOTSUPP;
+
+    union i2c_smbus_data smbus_data;
+    rc = access(I2C_SMBUS_READ, reg, I2C_SMBUS_BLOCK_DATA, &smbus_data);
+    if (rc < 0) return rc;
+
+    *len = std::min<uint8_t>(smbus_data.block[0], I2C_SMBUS_BLOCK_MAX);
+    std::copy(smbus_data.block + 1, smbus_data.block + 1 + *len, data);
+    return 0;
+}
+
+int SMBusBus::probe(uint8_t addr) {
+    int rc = selectSlave(addr);
+    if (rc < 0) return rc;
+
+    if (!probeByRead(addr) && (funcs & I2C_FUNC_SMBUS_QUICK)) {
+        return access(I2C_SMBUS_WRITE, 0, I2C_SMBUS_QUICK, nullptr);
+    }
+    union i2c_smbus_data smbus_data;
+    if (funcs & I2C_FUNC_SMBUS_READ_BYTE) {
+        return access(I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE, &smbus_data);
+    }
+    return access(I2C_SMBUS_READ, 0, I2C_SMBUS_BYTE_DATA, &smbus_data);
+}
+
+void SMBusBus::printStats(std::ostream& out) const {
+    I2CDevFdBus::printStats(out);
+    if (pec) {
+        out << "SMBus PEC: enabled\n";
+    }
+}
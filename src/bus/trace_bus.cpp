@@ -0,0 +1,227 @@
+#include "bus/trace_bus.hpp"
+#include "timing.hpp"
+#include <algorithm>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+static constexpr char TRACE_MAGIC[4] = {'I', '2', 'C', 'T'};
+static constexpr uint16_t TRACE_VERSION = 1;
+static constexpr size_t TRACE_HEADER_SIZE = 16;
+
+// Records start on 8-byte boundaries
+static size_t recordSize(size_t payload_len) {
+    return sizeof(TraceRecord) + ((payload_len + 7) & ~size_t(7));
+}
+
+static uint64_t realtimeNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+TraceWriter::TraceWriter(const std::string& path)
+    : file_path(path), fd(-1), map(nullptr), capacity(0), used(0),
+      pending(0), record_count(0), failed(false) {
+    fd = open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        throw std::runtime_error("Failed to open trace file: " + path);
+    }
+    if (!grow(TRACE_HEADER_SIZE)) {
+        close(fd);
+        throw std::runtime_error("Failed to map trace file: " + path);
+    }
+
+    uint16_t version = TRACE_VERSION;
+    uint16_t record_size = sizeof(TraceRecord);
+    uint64_t start = realtimeNowNs();
+    std::memcpy(map, TRACE_MAGIC, 4);
+    std::memcpy(map + 4, &version, 2);
+    std::memcpy(map + 6, &record_size, 2);
+    std::memcpy(map + 8, &start, 8);
+    used = TRACE_HEADER_SIZE;
+}
+
+TraceWriter::~TraceWriter() {
+    if (map) {
+        munmap(map, capacity);
+    }
+    // Drop the unused tail of the last chunk
+    if (ftruncate(fd, used) < 0) {
+        std::cerr << "Failed to truncate trace file " << file_path << "\n";
+    }
+    close(fd);
+}
+
+bool TraceWriter::grow(size_t needed) {
+    size_t size = std::max(capacity * 2, CHUNK_SIZE);
+    while (size < needed) size *= 2;
+
+    if (ftruncate(fd, size) < 0) return false;
+    void* mapped = map ? mremap(map, capacity, size, MREMAP_MAYMOVE)
+                       : mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (mapped == MAP_FAILED) return false;
+
+    map = static_cast<uint8_t*>(mapped);
+    capacity = size;
+    return true;
+}
+
+TraceRecord* TraceWriter::reserve(size_t payload_len) {
+    if (failed) return nullptr;
+
+    size_t needed = recordSize(payload_len);
+    if (used + needed > capacity && !grow(used + needed)) {
+        std::cerr << "Trace file " << file_path << " cannot grow, tracing stopped\n";
+        failed = true;
+        return nullptr;
+    }
+    pending = needed;
+    return reinterpret_cast<TraceRecord*>(map + used);
+}
+
+void TraceWriter::commit() {
+    used += pending;
+    pending = 0;
+    record_count++;
+}
+
+TraceReader::TraceReader(const std::string& path)
+    : file(path, "trace file"), offset(TRACE_HEADER_SIZE), start_realtime_ns(0) {
+    const uint8_t* map = file.data();
+    uint16_t version = 0;
+    uint16_t record_size = 0;
+    if (file.size() >= TRACE_HEADER_SIZE) {
+        std::memcpy(&version, map + 4, 2);
+        std::memcpy(&record_size, map + 6, 2);
+        std::memcpy(&start_realtime_ns, map + 8, 8);
+    }
+    if (file.size() < TRACE_HEADER_SIZE || std::memcmp(map, TRACE_MAGIC, 4) != 0 ||
+        version != TRACE_VERSION || record_size != sizeof(TraceRecord)) {
+        throw std::runtime_error("Not a bus trace: " + path);
+    }
+}
+
+bool TraceReader::next(const TraceRecord*& record, const uint8_t*& payload) {
+    // A trace cut short by a crash ends in zeroed or partial records
+    size_t size = file.size();
+    if (offset + sizeof(TraceRecord) > size) return false;
+    record = reinterpret_cast<const TraceRecord*>(file.data() + offset);
+    if (record->kind == TraceKind::END || offset + recordSize(record->len) > size) {
+        return false;
+    }
+    payload = file.data() + offset + sizeof(TraceRecord);
+    offset += recordSize(record->len);
+    return true;
+}
+
+TraceBus::TraceBus(std::unique_ptr<I2CBus> inner, const std::string& path)
+    : inner_bus(std::move(inner)), writer(path), origin_ns(monotonicNowNs()) {
+    setDevice(inner_bus->device());
+}
+
+void TraceBus::log(TraceKind kind, uint8_t addr, uint8_t reg, int rc, uint64_t start,
+                   const uint8_t* data, size_t len) {
+    uint64_t end = monotonicNowNs();
+    TraceRecord* record = writer.reserve(len);
+    if (!record) return;
+
+    record->timestamp_ns = start - origin_ns;
+    record->duration_ns = static_cast<uint32_t>(std::min<uint64_t>(end - start, UINT32_MAX));
+    record->result = rc;
+    record->kind = kind;
+    record->addr = addr;
+    record->reg = reg;
+    record->messages = 0;
+    record->len = len;
+    uint8_t* payload = reinterpret_cast<uint8_t*>(record + 1);
+    if (data) {
+        std::memcpy(payload, data, len);
+    } else {
+        std::memset(payload, 0, len);
+    }
+    writer.commit();
+}
+
+int TraceBus::readRegister(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+    uint64_t start = monotonicNowNs();
+    int rc = inner_bus->readRegister(addr, reg, data, len);
+    // Failed reads keep their length so a replay issues the same request
+    log(TraceKind::READ_REGISTER, addr, reg, rc, start, rc == 0 ? data : nullptr, len);
+    return rc;
+}
+
+int TraceBus::writeRegister(uint8_t addr, uint8_t reg, const uint8_t* data, uint16_t len) {
+    uint64_t start = monotonicNowNs();
+    int rc = inner_bus->writeRegister(addr, reg, data, len);
+    log(TraceKind::WRITE_REGISTER, addr, reg, rc, start, data, len);
+    return rc;
+}
+
+int TraceBus::writeBytes(uint8_t addr, const uint8_t* data, uint16_t len) {
+    uint64_t start = monotonicNowNs();
+    int rc = inner_bus->writeBytes(addr, data, len);
+    log(TraceKind::WRITE_BYTES, addr, 0, rc, start, data, len);
+    return rc;
+}
+
+int TraceBus::readBlockData(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t* len) {
+    uint64_t start = monotonicNowNs();
+    int rc = inner_bus->readBlockData(addr, reg, data, len);
+    log(TraceKind::READ_BLOCK_DATA, addr, reg, rc, start, data, rc == 0 ? *len : 0);
+    return rc;
+}
+
+int TraceBus::probe(uint8_t addr) {
+    uint64_t start = monotonicNowNs();
+    int rc = inner_bus->probe(addr);
+    log(TraceKind::PROBE, addr, 0, rc, start, nullptr, 0);
+    return rc;
+}
+
+int TraceBus::transfer(struct i2c_msg* msgs, size_t count) {
+    uint64_t start = monotonicNowNs();
+    int rc = inner_bus->transfer(msgs, count);
+    uint64_t end = monotonicNowNs();
+
+    size_t len = 0;
+    for (size_t i = 0; i < count; i++) {
+        len += 6 + msgs[i].len;
+    }
+    TraceRecord* record = writer.reserve(len);
+    if (!record) return rc;
+
+    record->timestamp_ns = start - origin_ns;
+    record->duration_ns = static_cast<uint32_t>(std::min<uint64_t>(end - start, UINT32_MAX));
+    record->result = rc;
+    record->kind = TraceKind::TRANSFER;
+    record->addr = count > 0 ? msgs[0].addr : 0;
+    record->reg = 0;
+    record->messages = count;
+    record->len = len;
+
+    uint8_t* p = reinterpret_cast<uint8_t*>(record + 1);
+    for (size_t i = 0; i < count; i++) {
+        uint16_t header[3] = {msgs[i].addr, msgs[i].flags, msgs[i].len};
+        std::memcpy(p, header, sizeof(header));
+        p += sizeof(header);
+        if (rc < 0 && (msgs[i].flags & I2C_M_RD)) {
+            std::memset(p, 0, msgs[i].len);
+        } else {
+            std::memcpy(p, msgs[i].buf, msgs[i].len);
+        }
+        p += msgs[i].len;
+    }
+    writer.commit();
+    return rc;
+}
+
+void TraceBus::printStats(std::ostream& out) const {
+    inner_bus->printStats(out);
+    out << "Trace: " << writer.records() << " transactions, " << writer.bytes()
+        << " bytes written to " << writer.path() << "\n";
+}
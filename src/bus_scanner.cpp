@@ -0,0 +1,129 @@
+#include "bus_scanner.hpp"
+#include "timing.hpp"
+#include <algorithm>
+#include <cstring>
+#include <filesystem>
+#include <iomanip>
+#include <thread>
+
+std::vector<std::string> listBuses() {
+    std::vector<std::string> buses;
+    std::error_code ec;
+    for (const auto& entry : std::filesystem::directory_iterator("/dev", ec)) {
+        std::string name = entry.path().filename().string();
+        if (name.compare(0, 4, "i2c-") == 0) {
+            buses.push_back(entry.path().string());
+        }
+    }
+    // Numeric order, so /dev/i2c-10 comes after /dev/i2c-9
+    std::sort(buses.begin(), buses.end(), [](const std::string& a, const std::string& b) {
+        return a.size() != b.size() ? a.size() < b.size() : a < b;
+    });
+    return buses;
+}
+
+static bool isBCD(uint8_t value, uint8_t max) {
+    return (value & 0x0F) <= 9 && value <= max;
+}
+
+// Chip ID register 0xD0 of the Bosch pressure sensors
+static const char* identifyBMP280(I2CBus& bus, uint8_t addr) {
+    uint8_t id = 0;
+    if (bus.readRegister(addr, 0xD0, &id, 1) < 0) return nullptr;
+    if (id == 0x58) return "BMP280";
+    if (id == 0x60) return "BME280";
+    return nullptr;
+}
+
+// The DS3231 has no ID register: its time registers hold BCD, status bits
+// 6:4 and the low six bits of the temperature LSB always read as zero
+static const char* identifyDS3231(I2CBus& bus, uint8_t addr) {
+    uint8_t regs[0x13];
+    if (bus.readRegister(addr, 0x00, regs, sizeof(regs)) < 0) return nullptr;
+    bool valid = isBCD(regs[0x00], 0x59) && isBCD(regs[0x01], 0x59) &&
+                 isBCD(regs[0x03], 0x07) && regs[0x03] != 0 &&
+                 isBCD(regs[0x04], 0x31) && isBCD(regs[0x05] & 0x7F, 0x12) &&
+                 (regs[0x0F] & 0x70) == 0 && (regs[0x12] & 0x3F) == 0;
+    return valid ? "DS3231" : nullptr;
+}
+
+// A 24Cxx answers anywhere in 0x50-0x57, but its size (and whether it
+// takes 1- or 2-byte word addresses) cannot be told apart without writing
+// to it: a 2-byte address sent to a 1-byte part stores a data byte. So the
+// part is recorded as an unidentified EEPROM.
+static const char* identifyEEPROM(I2CBus&, uint8_t) {
+    return UNKNOWN_EEPROM;
+}
+
+struct Fingerprint {
+    uint8_t first_addr;
+    uint8_t last_addr;
+    const char* (*identify)(I2CBus& bus, uint8_t addr);
+};
+
+static const Fingerprint FINGERPRINTS[] = {
+    {0x76, 0x77, identifyBMP280},
+    {0x68, 0x68, identifyDS3231},
+    {0x50, 0x57, identifyEEPROM},
+};
+
+std::string identifyDevice(I2CBus& bus, uint8_t addr) {
+    for (const Fingerprint& fingerprint : FINGERPRINTS) {
+        if (addr < fingerprint.first_addr || addr > fingerprint.last_addr) continue;
+        if (const char* part = fingerprint.identify(bus, addr)) {
+            return part;
+        }
+    }
+    return "?";
+}
+
+BusScan scanBus(const std::string& device, const BusOptions& options) {
+    BusScan scan;
+    scan.device = device;
+    uint64_t start = monotonicNowNs();
+    try {
+        std::unique_ptr<I2CBus> bus = createBus(device, options);
+        scan.backend = bus->name();
+        for (int addr = SCAN_FIRST_ADDR; addr <= SCAN_LAST_ADDR; addr++) {
+            int rc = bus->probe(addr);
+            if (rc == -EBUSY) {
+                scan.devices[addr] = "UU";
+            } else if (rc == 0) {
+                scan.devices[addr] = identifyDevice(*bus, addr);
+            }
+        }
+    } catch (const std::exception& e) {
+        scan.error = e.what();
+    }
+    scan.elapsed_ns = monotonicNowNs() - start;
+    return scan;
+}
+
+std::vector<BusScan> scanBuses(const std::vector<std::string>& devices, const BusOptions& options) {
+    // Each thread owns its bus and its result slot, so nothing is shared
+    std::vector<BusScan> scans(devices.size());
+    std::vector<std::thread> threads;
+    threads.reserve(devices.size());
+    for (size_t i = 0; i < devices.size(); i++) {
+        threads.emplace_back([&, i]() { scans[i] = scanBus(devices[i], options); });
+    }
+    for (std::thread& thread : threads) {
+        thread.join();
+    }
+    return scans;
+}
+
+void printScan(std::ostream& out, const BusScan& scan) {
+    if (!scan.error.empty()) {
+        out << scan.device << ": " << scan.error << "\n";
+        return;
+    }
+    out << scan.device << " (" << scan.backend << "): " << scan.devices.size()
+        << " device(s) in " << std::fixed << std::setprecision(1)
+        << scan.elapsed_ns / 1000000.0 << " ms\n";
+    out.unsetf(std::ios::floatfield);
+    for (const auto& device : scan.devices) {
+        out << "  0x" << std::hex << std::setw(2) << std::setfill('0') << (int)device.first
+            << std::dec << std::setfill(' ') << "  " << device.second << "\n";
+    }
+}
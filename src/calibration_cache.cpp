@@ -0,0 +1,99 @@
+#include "calibration_cache.hpp"
+#include "atomic_file.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+std::string CalibrationCache::defaultPath() {
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) {
+        return std::string(xdg) + "/i2c-player/calibration.csv";
+    }
+    const char* home = std::getenv("HOME");
+    if (home && *home) {
+        return std::string(home) + "/.cache/i2c-player/calibration.csv";
+    }
+    return "";
+}
+
+void CalibrationCache::setFile(const std::string& file) {
+    path = file;
+    entries.clear();
+    if (!path.empty()) {
+        load();
+    }
+}
+
+std::string CalibrationCache::key(const std::string& device, const std::string& bus,
+                                  uint8_t addr) {
+    std::stringstream ss;
+    ss << device << "," << bus << ",0x" << std::hex << std::setw(2) << std::setfill('0')
+       << static_cast<int>(addr);
+    return ss.str();
+}
+
+const std::vector<uint8_t>* CalibrationCache::find(const std::string& device,
+                                                   const std::string& bus, uint8_t addr) const {
+    auto entry = entries.find(key(device, bus, addr));
+    return entry != entries.end() ? &entry->second : nullptr;
+}
+
+void CalibrationCache::store(const std::string& device, const std::string& bus, uint8_t addr,
+                             const std::vector<uint8_t>& data) {
+    if (path.empty()) {
+        entries[key(device, bus, addr)] = data;
+        return;
+    }
+
+    // Another process may have added blocks since this one loaded the file,
+    // so reload under the lock and write the union back
+    FileLock lock(path);
+    load();
+    entries[key(device, bus, addr)] = data;
+    save();
+}
+
+void CalibrationCache::load() {
+    // Lines: device,bus,addr,hex bytes. A missing file is an empty cache and
+    // malformed lines are dropped, the block is simply read again.
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        size_t last = line.rfind(',');
+        if (last == std::string::npos) continue;
+
+        std::string hex = line.substr(last + 1);
+        if (hex.empty() || hex.size() % 2 != 0) continue;
+        std::vector<uint8_t> data;
+        try {
+            for (size_t i = 0; i < hex.size(); i += 2) {
+                data.push_back(std::stoi(hex.substr(i, 2), nullptr, 16));
+            }
+        } catch (const std::exception&) {
+            continue;
+        }
+        entries[line.substr(0, last)] = data;
+    }
+}
+
+void CalibrationCache::save() const {
+    std::ostringstream out;
+    out << "# device,bus,addr,calibration bytes\n";
+    for (const auto& entry : entries) {
+        out << entry.first << ",";
+        for (uint8_t byte : entry.second) {
+            out << std::hex << std::setw(2) << std::setfill('0') << static_cast<int>(byte);
+        }
+        out << std::dec << "\n";
+    }
+
+    // Readers see either the previous or the new cache, never a partial one
+    int rc = replaceFile(path, out.str());
+    if (rc < 0) {
+        std::cerr << "Cannot write calibration cache " << path << ": " << std::strerror(-rc) << "\n";
+    }
+}
@@ -0,0 +1,402 @@
+#include "daemon.hpp"
+#include "timing.hpp"
+#include <algorithm>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <stdexcept>
+#include <poll.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+static volatile sig_atomic_t stop_requested = 0;
+
+static void requestStop(int) {
+    stop_requested = 1;
+}
+
+static std::runtime_error socketError(const std::string& what, const std::string& path) {
+    return std::runtime_error(what + " " + path + ": " + std::strerror(errno));
+}
+
+static struct sockaddr_un socketAddress(const std::string& path) {
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(addr.sun_path)) {
+        throw std::runtime_error("Socket path too long: " + path);
+    }
+    std::memcpy(addr.sun_path, path.c_str(), path.size() + 1);
+    return addr;
+}
+
+// Redirects std::cout and std::cerr into a buffer for its lifetime
+class OutputCapture {
+public:
+    explicit OutputCapture(std::ostream& sink)
+        : out(std::cout.rdbuf(sink.rdbuf())), err(std::cerr.rdbuf(sink.rdbuf())) {}
+    ~OutputCapture() {
+        std::cout.flush();
+        std::cout.rdbuf(out);
+        std::cerr.rdbuf(err);
+    }
+
+private:
+    std::streambuf* out;
+    std::streambuf* err;
+};
+
+std::string I2CDaemon::defaultSocketPath() {
+    const char* runtime = std::getenv("XDG_RUNTIME_DIR");
+    if (runtime && *runtime) {
+        return std::string(runtime) + "/i2c-player.sock";
+    }
+    return "/tmp/i2c-player.sock";
+}
+
+I2CDaemon::I2CDaemon(I2CPlayer& player_, const std::string& path, bool verbose_mode,
+                     ErrorAction action)
+    : player(player_), socket_path(path), verbose(verbose_mode), listen_fd(-1),
+      compiler(verbose_mode, action), next_client(0) {
+    struct sockaddr_un addr = socketAddress(path);
+
+    // A socket file left behind by a crashed daemon is reused, a live one is not
+    struct stat st;
+    if (lstat(path.c_str(), &st) == 0 && S_ISSOCK(st.st_mode)) {
+        int probe = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        bool live = probe >= 0 &&
+                    connect(probe, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) == 0;
+        if (probe >= 0) close(probe);
+        if (live) {
+            throw std::runtime_error("Another daemon is serving " + path);
+        }
+        unlink(path.c_str());
+    }
+
+    listen_fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (listen_fd < 0) {
+        throw socketError("Failed to create daemon socket", path);
+    }
+    if (bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0 ||
+        listen(listen_fd, BACKLOG) < 0) {
+        std::runtime_error error = socketError("Failed to listen on", path);
+        close(listen_fd);
+        throw error;
+    }
+}
+
+I2CDaemon::~I2CDaemon() {
+    for (const Client& client : clients) {
+        close(client.fd);
+    }
+    close(listen_fd);
+    unlink(socket_path.c_str());
+}
+
+void I2CDaemon::serve() {
+    struct sigaction action = {};
+    action.sa_handler = requestStop;
+    sigemptyset(&action.sa_mask);
+    // No SA_RESTART, so poll() returns when a signal arrives
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    signal(SIGPIPE, SIG_IGN);
+
+    std::cout << "Serving requests on " << socket_path << "\n";
+
+    std::vector<struct pollfd> fds;
+    bool pending = false;
+    while (!stop_requested) {
+        fds.clear();
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (const Client& client : clients) {
+            // Nothing more arrives after EOF, only buffered requests remain
+            fds.push_back({client.fd, static_cast<short>(client.eof ? 0 : POLLIN), 0});
+        }
+
+        // Complete requests may still be buffered from the last pass
+        int rc = poll(fds.data(), fds.size(), pending ? 0 : -1);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            throw std::runtime_error(std::string("poll failed: ") + std::strerror(errno));
+        }
+
+        if (fds[0].revents & POLLIN) {
+            acceptClients();
+        }
+        for (size_t i = 1; i < fds.size(); i++) {
+            if (fds[i].revents && !clients[i - 1].eof && !receive(clients[i - 1])) {
+                close(clients[i - 1].fd);
+                clients[i - 1].fd = -1;
+            }
+        }
+        clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                     [](const Client& c) { return c.fd < 0; }),
+                      clients.end());
+
+        // One request per client and pass, starting with a different client
+        // each time, so a client streaming requests cannot starve the others
+        pending = false;
+        std::string request;
+        size_t count = clients.size();
+        for (size_t n = 0; n < count; n++) {
+            Client& client = clients[(next_client + n) % count];
+            if (!nextRequest(client, request)) continue;
+
+            uint64_t start = monotonicNowNs();
+            bool ok = execute(request);
+            if (!reply(client, ok)) {
+                close(client.fd);
+                client.fd = -1;
+                continue;
+            }
+            if (verbose) {
+                std::cerr << "Request " << request.substr(0, request.find('\n')) << ": "
+                          << (ok ? "ok" : "error") << " in "
+                          << (monotonicNowNs() - start) / 1000 << " us\n";
+            }
+            pending = pending || hasRequest(client);
+        }
+        if (count > 0) {
+            next_client = (next_client + 1) % count;
+        }
+
+        // A client that closed its side is dropped once its requests are served
+        for (Client& client : clients) {
+            if (client.fd >= 0 && client.eof && !hasRequest(client)) {
+                close(client.fd);
+                client.fd = -1;
+            }
+        }
+        clients.erase(std::remove_if(clients.begin(), clients.end(),
+                                     [](const Client& c) { return c.fd < 0; }),
+                      clients.end());
+    }
+
+    std::cout << "Daemon stopped\n";
+}
+
+void I2CDaemon::acceptClients() {
+    int fd = accept4(listen_fd, nullptr, nullptr, SOCK_CLOEXEC);
+    if (fd < 0) return;
+
+    // A client that stops reading must not stall the bus for the others
+    struct timeval timeout = {1, 0};
+    setsockopt(fd, SOL_SOCKET, SO_SNDTIMEO, &timeout, sizeof(timeout));
+    clients.push_back({fd, std::string(), false});
+}
+
+bool I2CDaemon::receive(Client& client) {
+    char buffer[4096];
+    ssize_t n = read(client.fd, buffer, sizeof(buffer));
+    if (n == 0) {
+        client.eof = true;
+        return true;
+    }
+    if (n < 0) {
+        return errno == EINTR;
+    }
+    // CRLF clients are served like LF ones, including the EXEC terminator
+    for (ssize_t i = 0; i < n; i++) {
+        if (buffer[i] != '\r') client.input += buffer[i];
+    }
+    return client.input.size() <= MAX_REQUEST;
+}
+
+// End of the first complete request in input, 0 if there is none yet.
+// text_end is where the request text ends (before an EXEC terminator).
+static size_t requestEnd(const std::string& input, size_t& text_end) {
+    size_t eol = input.find('\n');
+    if (eol == std::string::npos) return 0;
+
+    if (input.compare(0, eol, "EXEC") == 0) {
+        // Inline script lines follow until a line holding a single '.'
+        size_t terminator = input.find("\n.\n", eol);
+        if (terminator == std::string::npos) return 0;
+        text_end = terminator + 1;
+        return terminator + 3;
+    }
+    text_end = eol;
+    return eol + 1;
+}
+
+bool I2CDaemon::hasRequest(const Client& client) {
+    size_t text_end;
+    return requestEnd(client.input, text_end) != 0;
+}
+
+bool I2CDaemon::nextRequest(Client& client, std::string& request) {
+    size_t text_end = 0;
+    size_t end = requestEnd(client.input, text_end);
+    if (end == 0) return false;
+    request.assign(client.input, 0, text_end);
+    client.input.erase(0, end);
+    return true;
+}
+
+static std::string trimmed(const std::string& str) {
+    size_t first = str.find_first_not_of(" \t\r");
+    if (first == std::string::npos) return "";
+    return str.substr(first, str.find_last_not_of(" \t\r") - first + 1);
+}
+
+static unsigned long parseField(const std::string& field, int base, unsigned long min,
+                                unsigned long max, const char* what) {
+    size_t used = 0;
+    unsigned long value = 0;
+    try {
+        value = std::stoul(field, &used, base);
+    } catch (const std::exception&) {
+        used = 0;
+    }
+    if (field.empty() || used != field.size() || value < min || value > max) {
+        throw std::runtime_error(std::string("Invalid ") + what + ": " + field);
+    }
+    return value;
+}
+
+bool I2CDaemon::execute(const std::string& request) {
+    output.str("");
+    output.clear();
+    OutputCapture capture(output);
+
+    try {
+        size_t eol = request.find('\n');
+        std::string line = trimmed(request.substr(0, eol));
+        size_t space = line.find(' ');
+        std::string command = line.substr(0, space);
+        std::string args = space == std::string::npos ? "" : trimmed(line.substr(space + 1));
+
+        if (command == "PING") {
+            return true;
+        }
+        if (command == "RUN") {
+            if (args.empty()) throw std::runtime_error("RUN requires a script path");
+            const Program& program = script(args);
+            checkSamples(program);
+            player.run(program);
+            return true;
+        }
+        if (command == "EXEC") {
+            // A fresh compiler, so SUBs of one request do not leak into the next
+            ScriptCompiler inline_compiler(verbose, ErrorAction::STOP);
+            ScriptCompiler::State state;
+            state.header_skipped = true;
+            Program program;
+            program.source = "<inline>";
+            std::string_view body(request);
+            body.remove_prefix(eol == std::string::npos ? body.size() : eol + 1);
+            while (!body.empty()) {
+                size_t next = body.find('\n');
+                inline_compiler.compileLine(body.substr(0, next), state, program);
+                body.remove_prefix(next == std::string_view::npos ? body.size() : next + 1);
+            }
+            inline_compiler.finish(state, program);
+            checkSamples(program);
+            player.run(program);
+            return true;
+        }
+        if (command == "READ") {
+            std::istringstream fields(args);
+            std::string addr, reg, len, device;
+            fields >> addr >> reg >> len >> device;
+            player.readFrame(parseField(addr, 16, 0, 0x7F, "address"),
+                             parseField(reg, 16, 0, 0xFF, "register"),
+                             parseField(len, 10, 1, 0xFFFF, "length"), device);
+            return true;
+        }
+        throw std::runtime_error("Unknown request: " + command);
+    } catch (const std::exception& e) {
+        output << "Error: " << e.what() << "\n";
+        return false;
+    }
+}
+
+const Program& I2CDaemon::script(const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) < 0) {
+        throw std::runtime_error("Failed to open input file: " + path);
+    }
+
+    // Recompile only when the file changed; INCLUDEd files are not checked
+    auto cached = scripts.find(path);
+    if (cached != scripts.end() && cached->second.size == st.st_size &&
+        cached->second.mtime.tv_sec == st.st_mtim.tv_sec &&
+        cached->second.mtime.tv_nsec == st.st_mtim.tv_nsec) {
+        return cached->second.program;
+    }
+
+    CachedScript entry{st.st_mtim, st.st_size, compiler.compileFile(path)};
+    return scripts.insert_or_assign(path, std::move(entry)).first->second.program;
+}
+
+void I2CDaemon::checkSamples(const Program& program) const {
+    if (player.sampleOutput() != "-") return;
+    for (const Instruction& ins : program.code) {
+        if (ins.op == OpCode::SAMPLE) {
+            throw std::runtime_error("SAMPLE at line " + std::to_string(ins.line) +
+                                     " would write to the daemon's stdout, not to this client;"
+                                     " start the daemon with --sample-out=<file>");
+        }
+    }
+}
+
+bool I2CDaemon::reply(Client& client, bool ok) {
+    const std::string& payload = output.str();
+    response.assign(ok ? "OK " : "ERR ");
+    response += std::to_string(payload.size());
+    response += '\n';
+    response += payload;
+
+    size_t sent = 0;
+    while (sent < response.size()) {
+        ssize_t n = send(client.fd, response.data() + sent, response.size() - sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return false;
+        }
+        sent += n;
+    }
+    return true;
+}
+
+int runDaemonClient(const std::string& socket_path, const std::string& request) {
+    struct sockaddr_un addr = socketAddress(socket_path);
+    int fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    if (fd < 0 || connect(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) < 0) {
+        std::runtime_error error = socketError("Failed to connect to daemon at", socket_path);
+        if (fd >= 0) close(fd);
+        throw error;
+    }
+
+    std::string message = request + "\n";
+    ssize_t sent = send(fd, message.data(), message.size(), MSG_NOSIGNAL);
+
+    // "OK <n>\n" or "ERR <n>\n", then n bytes of output
+    std::string input;
+    char buffer[4096];
+    ssize_t n = 0;
+    size_t header_end = std::string::npos;
+    size_t length = 0;
+    while (sent == static_cast<ssize_t>(message.size()) && (n = read(fd, buffer, sizeof(buffer))) > 0) {
+        input.append(buffer, n);
+        if (header_end == std::string::npos) {
+            header_end = input.find('\n');
+            if (header_end == std::string::npos) continue;
+            length = std::strtoul(input.c_str() + input.find(' ') + 1, nullptr, 10);
+        }
+        if (input.size() >= header_end + 1 + length) break;
+    }
+    close(fd);
+
+    if (header_end == std::string::npos || input.size() < header_end + 1 + length) {
+        throw std::runtime_error("Incomplete reply from daemon at " + socket_path);
+    }
+    bool ok = input.compare(0, 3, "OK ") == 0;
+    (ok ? std::cout : std::cerr) << input.substr(header_end + 1, length);
+    return ok ? 0 : 1;
+}
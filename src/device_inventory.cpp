@@ -0,0 +1,102 @@
+#include "device_inventory.hpp"
+#include "atomic_file.hpp"
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+
+std::string DeviceInventory::defaultPath() {
+    const char* xdg = std::getenv("XDG_CACHE_HOME");
+    if (xdg && *xdg) {
+        return std::string(xdg) + "/i2c-player/inventory.csv";
+    }
+    const char* home = std::getenv("HOME");
+    if (home && *home) {
+        return std::string(home) + "/.cache/i2c-player/inventory.csv";
+    }
+    return "";
+}
+
+void DeviceInventory::setFile(const std::string& file) {
+    path = file;
+    buses.clear();
+    if (!path.empty()) {
+        load();
+    }
+}
+
+void DeviceInventory::update(const std::string& bus, const std::map<uint8_t, std::string>& devices) {
+    if (path.empty()) {
+        buses[bus] = devices;
+        return;
+    }
+
+    // A concurrent --scan of another bus may have saved since setFile();
+    // start from the file's current contents so its buses are kept, and
+    // replace only the bus scanned here
+    FileLock lock(path);
+    buses.clear();
+    load();
+    buses[bus] = devices;
+    save();
+}
+
+bool DeviceInventory::scanned(const std::string& bus) const {
+    return buses.count(bus) != 0;
+}
+
+const std::string* DeviceInventory::find(const std::string& bus, uint8_t addr) const {
+    auto devices = buses.find(bus);
+    if (devices == buses.end()) return nullptr;
+    auto device = devices->second.find(addr);
+    return device != devices->second.end() ? &device->second : nullptr;
+}
+
+void DeviceInventory::load() {
+    // Lines: bus,addr,part, or bus,-,- for a bus where nothing answered.
+    // A missing file is an empty inventory and malformed lines are dropped.
+    std::ifstream file(path);
+    std::string line;
+    while (std::getline(file, line)) {
+        if (line.empty() || line[0] == '#') continue;
+        size_t last = line.rfind(',');
+        if (last == std::string::npos || last == 0) continue;
+        size_t first = line.rfind(',', last - 1);
+        if (first == std::string::npos) continue;
+
+        std::string bus = line.substr(0, first);
+        std::string addr = line.substr(first + 1, last - first - 1);
+        std::map<uint8_t, std::string>& devices = buses[bus];
+        if (addr == "-") continue;
+        try {
+            size_t used = 0;
+            unsigned long value = std::stoul(addr, &used, 16);
+            if (used != addr.size() || value > 0x7F) continue;
+            devices[value] = line.substr(last + 1);
+        } catch (const std::exception&) {
+            continue;
+        }
+    }
+}
+
+void DeviceInventory::save() const {
+    std::ostringstream out;
+    out << "# bus,addr,part (? = not identified, UU = claimed by a kernel driver)\n";
+    for (const auto& bus : buses) {
+        if (bus.second.empty()) {
+            out << bus.first << ",-,-\n";
+        }
+        for (const auto& device : bus.second) {
+            out << bus.first << ",0x" << std::hex << std::setw(2) << std::setfill('0')
+                << static_cast<int>(device.first) << std::dec << "," << device.second << "\n";
+        }
+    }
+
+    // Runs checking the inventory never read a half-written file
+    int rc = replaceFile(path, out.str());
+    if (rc < 0) {
+        std::cerr << "Cannot write device inventory " << path << ": " << std::strerror(-rc) << "\n";
+    }
+}
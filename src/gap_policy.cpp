@@ -0,0 +1,116 @@
+#include "gap_policy.hpp"
+#include "script_compiler.hpp"
+#include "timing.hpp"
+#include <algorithm>
+#include <fstream>
+#include <stdexcept>
+#include <vector>
+
+GapPolicy::GapPolicy() : has_profiles(false), has_file_profiles(false) {
+    has_profile.fill(false);
+    has_file_profile.fill(false);
+    reset();
+}
+
+void GapPolicy::setDefault(const DeviceTiming& timing) {
+    default_timing = timing;
+}
+
+void GapPolicy::setProfile(uint8_t addr, const DeviceTiming& timing) {
+    profiles[addr & 0x7F] = timing;
+    has_profile[addr & 0x7F] = true;
+    has_profiles = true;
+}
+
+void GapPolicy::resetProfiles() {
+    profiles = file_profiles;
+    has_profile = has_file_profile;
+    has_profiles = has_file_profiles;
+}
+
+void GapPolicy::reset() {
+    last_write_end.fill(0);
+    last_end = 0;
+    last_addr = -1;
+}
+
+void GapPolicy::loadFile(const std::string& filename) {
+    std::ifstream file(filename);
+    if (!file.is_open()) {
+        throw std::runtime_error("Failed to open timing file: " + filename);
+    }
+
+    std::string line;
+    int line_number = 0;
+    while (std::getline(file, line)) {
+        line_number++;
+        size_t first = line.find_first_not_of(" \t\r\n");
+        if (first == std::string::npos || line[first] == '#') continue;
+
+        // Split on every comma, so a trailing comma counts as an extra field
+        std::vector<std::string> tokens;
+        size_t start = 0;
+        for (size_t comma; (comma = line.find(',', start)) != std::string::npos; start = comma + 1) {
+            tokens.push_back(line.substr(start, comma - start));
+        }
+        tokens.push_back(line.substr(start));
+
+        try {
+            if (tokens.size() != 4) throw std::runtime_error("expected addr,bus_free_us,settle_us,conversion_us");
+            // Same strict field checks as TIMING lines in a script
+            DeviceTiming timing;
+            timing.bus_free_us = ScriptCompiler::parseInt(
+                ScriptCompiler::trim(tokens[1]), 0, UINT32_MAX, "bus free time");
+            timing.write_settle_us = ScriptCompiler::parseInt(
+                ScriptCompiler::trim(tokens[2]), 0, UINT32_MAX, "settle time");
+            timing.conversion_us = ScriptCompiler::parseInt(
+                ScriptCompiler::trim(tokens[3]), 0, UINT32_MAX, "conversion time");
+            setProfile(ScriptCompiler::parseAddress(ScriptCompiler::trim(tokens[0])), timing);
+        } catch (const std::exception& e) {
+            throw std::runtime_error(filename + ":" + std::to_string(line_number) + ": " + e.what());
+        }
+    }
+
+    file_profiles = profiles;
+    has_file_profile = has_profile;
+    has_file_profiles = has_profiles;
+}
+
+const DeviceTiming& GapPolicy::profile(uint8_t addr) const {
+    return has_profile[addr & 0x7F] ? profiles[addr & 0x7F] : default_timing;
+}
+
+bool GapPolicy::needsGap(uint8_t addr) const {
+    if (!has_profile[addr & 0x7F]) return false;
+    const DeviceTiming& timing = profiles[addr & 0x7F];
+    return timing.bus_free_us || timing.write_settle_us || timing.conversion_us;
+}
+
+void GapPolicy::beforeTransaction(uint8_t addr, bool is_read) {
+    const DeviceTiming& target = profile(addr);
+    uint64_t earliest = 0;
+
+    if (last_addr >= 0) {
+        earliest = last_end + profile(last_addr).bus_free_us * 1000ull;
+    }
+
+    uint64_t written = last_write_end[addr & 0x7F];
+    if (written != 0) {
+        earliest = std::max<uint64_t>(earliest, written + target.write_settle_us * 1000ull);
+        if (is_read) {
+            earliest = std::max<uint64_t>(earliest, written + target.conversion_us * 1000ull);
+        }
+    }
+
+    if (earliest > monotonicNowNs()) {
+        sleepUntilNs(earliest);
+    }
+}
+
+void GapPolicy::afterTransaction(uint8_t addr, bool is_write) {
+    last_end = monotonicNowNs();
+    last_addr = addr & 0x7F;
+    if (is_write) {
+        last_write_end[addr & 0x7F] = last_end;
+    }
+}
@@ -1,254 +1,234 @@
 #include "i2c_player.hpp"
-#include <fcntl.h>
-#include <unistd.h>
-#include <sys/ioctl.h>
-#include <linux/i2c-dev.h>
+#include "timing.hpp"
+#include "bus/trace_bus.hpp"
+#include "script_stream.hpp"
 #include <fstream>
-#include <sstream>
 #include <filesystem>
-#include <thread>
-#include <chrono>
 #include <iomanip>
 #include <iostream>
+#include <algorithm>
+#include <bitset>
+#include <cstring>
+#include <sstream>
 
 I2CPlayer::I2CPlayer(const std::string& device, bool verbose_mode,
                      int wait_ms, ErrorAction action, int retries)
-    : device_path(device), verbose(verbose_mode),
-      i2c_wait_ms(wait_ms), error_action(action),
-      retry_count(retries), recording(false) {
-
-    i2c_fd = open(device_path.c_str(), O_RDWR);
-    if (i2c_fd < 0) {
-        throw std::runtime_error("Failed to open I2C device: " + device_path);
-    }
+    : I2CPlayer(createBus(device, BusOptions(), verbose_mode), verbose_mode,
+                wait_ms, action, retries) {
 }
 
-I2CPlayer::~I2CPlayer() {
-    if (i2c_fd >= 0) {
-        close(i2c_fd);
-    }
+I2CPlayer::I2CPlayer(std::unique_ptr<I2CBus> bus_backend, bool verbose_mode,
+                     int wait_ms, ErrorAction action, int retries)
+    : bus(std::move(bus_backend)), verbose(verbose_mode),
+      i2c_wait_ms(wait_ms), error_action(action),
+      retry(retries, action, wait_ms * 2000), batch_mode(false), eeprom_sync(false),
+      sample_path("-"), sample_format(SampleFormat::CSV), sample_ring_frames(4096),
+      recording(false), output_format(OutputFormat::REPORT), emitter(std::cout),
+      stats_start_ns(0) {
 }
 
+I2CPlayer::~I2CPlayer() = default;
+
 void I2CPlayer::registerParser(const std::string& device_name, 
                              std::unique_ptr<I2CDeviceParser> parser) {
     parsers[device_name] = std::move(parser);
 }
 
-bool I2CPlayer::checkNAK(const char* operation) {
-    if (errno == ENXIO || errno == EIO) {
-        std::cerr << "NAK detected during " << operation << "\n";
+void I2CPlayer::checkResult(int rc, const char* operation) {
+    if (rc == 0) return;
 
-        switch(error_action) {
-            case ErrorAction::STOP:
-                throw std::runtime_error("I2C NAK - device not responding");
-            case ErrorAction::RETRY:
-                return true;
-            case ErrorAction::CONTINUE:
-                std::cerr << "Continuing after NAK...\n";
-                return false;
+    if (RetryEngine::isNAK(-rc)) {
+        std::cerr << "NAK detected during " << operation << "\n";
+        if (error_action == ErrorAction::CONTINUE) {
+            std::cerr << "Continuing after NAK...\n";
+            return;
         }
+        throw std::runtime_error("I2C NAK - device not responding");
     }
-    return false;
+    throw std::runtime_error(std::string(operation) + " failed: " + std::strerror(-rc));
 }
 
-uint8_t I2CPlayer::readByte(uint8_t addr, uint8_t reg) {
-    for(int attempt = 0; attempt <= retry_count; attempt++) {
-        try {
-            if (ioctl(i2c_fd, I2C_SLAVE, addr) < 0) {
-                throw std::runtime_error("Failed to set I2C slave address for reading");
-            }
-
-            if (write(i2c_fd, &reg, 1) != 1) {
-                if (checkNAK("register write")) {
-                    if (attempt < retry_count) continue;
-                    throw std::runtime_error("Failed to write register address after retries");
-                }
-            }
+void I2CPlayer::printRetries() const {
+    if (retry.lastRetries() > 0) {
+        std::cout << " (retry " << retry.lastRetries() << ")";
+    }
+    std::cout << "\n";
+}
 
-            uint8_t data;
-            if (read(i2c_fd, &data, 1) != 1) {
-                if (checkNAK("data read")) {
-                    if (attempt < retry_count) continue;
-                    throw std::runtime_error("Failed to read I2C data after retries");
-                }
-            }
+int I2CPlayer::readByte(uint8_t addr, uint8_t reg, uint8_t& data) {
+    int rc = retry.execute(addr, [&]() {
+        return bus->readRegister(addr, reg, &data, 1);
+    });
 
-            if (verbose) {
-                std::cout << "Read: 0x" << std::hex << (int)addr
-                         << " reg:0x" << (int)reg
-                         << " data:0x" << (int)data << std::dec;
-                if (attempt > 0) {
-                    std::cout << " (retry " << attempt << ")";
-                }
-                std::cout << "\n";
-            }
+    if (rc == 0 && verbose) {
+        std::cout << "Read: 0x" << std::hex << (int)addr
+                 << " reg:0x" << (int)reg
+                 << " data:0x" << (int)data << std::dec;
+        printRetries();
+    }
+    return rc;
+}
 
-            return data;
+int I2CPlayer::readBlock(uint8_t addr, uint8_t reg, uint8_t* data, uint16_t len) {
+    int rc = retry.execute(addr, [&]() {
+        return bus->readRegister(addr, reg, data, len);
+    });
 
-        } catch (const std::exception& e) {
-            if (attempt == retry_count) throw;
-            if (verbose) {
-                std::cout << "Retry " << (attempt + 1) << "/" << retry_count
-                         << ": " << e.what() << "\n";
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(i2c_wait_ms * 2));
+    if (rc == 0 && verbose) {
+        std::cout << "ReadN: 0x" << std::hex << (int)addr
+                 << " reg:0x" << (int)reg << " data:";
+        for (uint16_t i = 0; i < len; i++) {
+            std::cout << " 0x" << (int)data[i];
         }
+        std::cout << std::dec;
+        printRetries();
     }
-    throw std::runtime_error("Read failed after all retries");
+    return rc;
 }
 
-void I2CPlayer::writeByte(uint8_t addr, uint8_t reg, uint8_t data) {
-    for(int attempt = 0; attempt <= retry_count; attempt++) {
-        try {
-            if (ioctl(i2c_fd, I2C_SLAVE, addr) < 0) {
-                throw std::runtime_error("Failed to set I2C slave address");
-            }
+int I2CPlayer::readBlockData(uint8_t addr, uint8_t reg, uint8_t* data, uint8_t& len) {
+    int rc = retry.execute(addr, [&]() {
+        return bus->readBlockData(addr, reg, data, &len);
+    });
 
-            uint8_t buf[2] = {reg, data};
-            if (write(i2c_fd, buf, 2) != 2) {
-                if (checkNAK("write")) {
-                    if (attempt < retry_count) continue;
-                    throw std::runtime_error("Failed to write I2C data after retries");
-                }
-            }
+    if (rc == 0 && verbose) {
+        std::cout << "ReadBlock: 0x" << std::hex << (int)addr
+                 << " reg:0x" << (int)reg << std::dec << " len:" << (int)len;
+        printRetries();
+    }
+    return rc;
+}
 
-            if (verbose) {
-                std::cout << "Write: 0x" << std::hex << (int)addr
-                         << " reg:0x" << (int)reg
-                         << " data:0x" << (int)data << std::dec;
-                if (attempt > 0) {
-                    std::cout << " (retry " << attempt << ")";
-                }
-                std::cout << "\n";
-            }
-            return;
+int I2CPlayer::writeByte(uint8_t addr, uint8_t reg, uint8_t data) {
+    int rc = retry.execute(addr, [&]() {
+        return bus->writeRegister(addr, reg, &data, 1);
+    });
 
-        } catch (const std::exception& e) {
-            if (attempt == retry_count) throw;
-            if (verbose) {
-                std::cout << "Retry " << (attempt + 1) << "/" << retry_count
-                         << ": " << e.what() << "\n";
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(i2c_wait_ms * 2));
-        }
+    if (rc == 0 && verbose) {
+        std::cout << "Write: 0x" << std::hex << (int)addr
+                 << " reg:0x" << (int)reg
+                 << " data:0x" << (int)data << std::dec;
+        printRetries();
     }
-    throw std::runtime_error("Write failed after all retries");
+    return rc;
 }
 
-void I2CPlayer::writeSingleByte(uint8_t addr, uint8_t data) {
-    for(int attempt = 0; attempt <= retry_count; attempt++) {
-        try {
-            if (ioctl(i2c_fd, I2C_SLAVE, addr) < 0) {
-                throw std::runtime_error("Failed to set I2C slave address");
-            }
+int I2CPlayer::writeSingleByte(uint8_t addr, uint8_t data) {
+    int rc = retry.execute(addr, [&]() {
+        return bus->writeBytes(addr, &data, 1);
+    });
 
-            if (write(i2c_fd, &data, 1) != 1) {
-                if (checkNAK("write")) {
-                    if (attempt < retry_count) continue;
-                    throw std::runtime_error("Failed to write I2C data after retries");
-                }
-            }
-            fsync(i2c_fd);
+    if (rc == 0 && verbose) {
+        std::cout << "Single Write: 0x" << std::hex << (int)addr
+                 << " data:0x" << (int)data << std::dec;
+        printRetries();
+    }
+    return rc;
+}
 
-            if (verbose) {
-                std::cout << "Single Write: 0x" << std::hex << (int)addr
-                         << " data:0x" << (int)data << std::dec;
-                if (attempt > 0) {
-                    std::cout << " (retry " << attempt << ")";
-                }
-                std::cout << "\n";
-            }
-            return;
+int I2CPlayer::write16Bit(uint8_t addr, uint8_t reg, uint16_t data) {
+    uint8_t buf[2] = {
+        static_cast<uint8_t>(data & 0xFF),
+        static_cast<uint8_t>((data >> 8) & 0xFF)
+    };
 
-        } catch (const std::exception& e) {
-            if (attempt == retry_count) throw;
-            if (verbose) {
-                std::cout << "Retry " << (attempt + 1) << "/" << retry_count
-                         << ": " << e.what() << "\n";
-            }
-            std::this_thread::sleep_for(std::chrono::milliseconds(i2c_wait_ms * 2));
-        }
+    int rc = retry.execute(addr, [&]() {
+        return bus->writeRegister(addr, reg, buf, 2);
+    });
+
+    if (rc == 0 && verbose) {
+        std::cout << "Write16: 0x" << std::hex << (int)addr
+                 << " reg:0x" << (int)reg
+                 << " data:0x" << data << std::dec;
+        printRetries();
     }
-    throw std::runtime_error("Write failed after all retries");
+    return rc;
 }
 
-void I2CPlayer::write16Bit(uint8_t addr, uint8_t reg, uint16_t data) {
-    for(int attempt = 0; attempt <= retry_count; attempt++) {
-        try {
-            if (ioctl(i2c_fd, I2C_SLAVE, addr) < 0) {
-                throw std::runtime_error("Failed to set I2C slave address");
-            }
+bool I2CPlayer::poll(const PollSpec& spec, PollStats& stats) {
+    uint64_t start = monotonicNowNs();
+    uint64_t deadline = start + spec.timeout_us * 1000ull;
+    uint64_t next_read = start + spec.holdoff_us * 1000ull;
+    uint64_t interval_ns = spec.min_interval_us * 1000ull;
+    uint64_t max_interval_ns = spec.max_interval_us * 1000ull;
 
-            uint8_t buf[3] = {
-                reg,
-                static_cast<uint8_t>(data & 0xFF),
-                static_cast<uint8_t>((data >> 8) & 0xFF)
-            };
+    // Bit i is set once condition i was met; met conditions are not read again
+    uint32_t met = 0;
+    uint32_t all_met = (1u << spec.condition_count) - 1;
+    unsigned reads = 0;
 
-            if (write(i2c_fd, buf, 3) != 3) {
-                if (checkNAK("16-bit write")) {
-                    if (attempt < retry_count) continue;
-                    throw std::runtime_error("Failed to write 16-bit I2C data after retries");
-                }
-            }
+    while (true) {
+        if (next_read > monotonicNowNs()) {
+            LatencyStats::Scope sleep(latency, TimeCategory::SLEEP);
+            sleepUntilNs(std::min(next_read, deadline));
+        }
 
-            if (verbose) {
-                std::cout << "Write16: 0x" << std::hex << (int)addr
-                         << " reg:0x" << (int)reg
-                         << " data:0x" << data << std::dec;
-                if (attempt > 0) {
-                    std::cout << " (retry " << attempt << ")";
-                }
-                std::cout << "\n";
+        int error = 0;
+        size_t unmet = 0;
+        uint8_t value = 0;
+        for (size_t i = 0; i < spec.condition_count; i++) {
+            if (met & (1u << i)) continue;
+            const PollCondition& condition = spec.conditions[i];
+            reads++;
+            // One attempt per read: the poll schedule is the retry, and a
+            // device busy converting may NAK until it is ready
+            int rc = retry.execute(condition.addr, [&]() {
+                return bus->readRegister(condition.addr, condition.reg, &value, 1);
+            }, 0);
+            if (rc < 0) {
+                error = rc;
+                unmet = i;
+                continue;
             }
-            return;
-
-        } catch (const std::exception& e) {
-            if (attempt == retry_count) throw;
-            if (verbose) {
-                std::cout << "Retry " << (attempt + 1) << "/" << retry_count
-                         << ": " << e.what() << "\n";
+            if ((value & condition.mask) == condition.expected) {
+                met |= 1u << i;
+                if (spec.any) break;
+            } else {
+                unmet = i;
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(i2c_wait_ms * 2));
         }
-    }
-    throw std::runtime_error("16-bit Write failed after all retries");
-}
-
-bool I2CPlayer::pollRegister(uint8_t addr, uint8_t reg, uint8_t mask, uint8_t expected,
-                            int timeout_ms, int interval_ms) {
-    auto start = std::chrono::steady_clock::now();
 
-    while (true) {
-        try {
-            uint8_t value = readByte(addr, reg);
-            if ((value & mask) == expected) {
-                return true;
+        uint64_t now = monotonicNowNs();
+        if (met == all_met || (spec.any && met != 0)) {
+            stats.add(now - start, reads, true);
+            if (verbose) {
+                std::cout << "Poll satisfied after " << reads << " reads in "
+                          << (now - start) / 1000 << " us\n";
             }
+            return true;
+        }
 
-            auto now = std::chrono::steady_clock::now();
-            auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(now - start);
-            if (elapsed.count() >= timeout_ms) {
-                if (verbose) {
-                    std::cout << "Polling timeout on register 0x" << std::hex << (int)reg
-                             << ": got 0x" << (int)value << ", expected 0x" << (int)expected
-                             << " (mask: 0x" << (int)mask << ")" << std::dec << "\n";
-                }
-                return false;
+        if (now >= deadline) {
+            stats.add(now - start, reads, false);
+            if (error < 0 && error_action == ErrorAction::STOP) {
+                checkResult(error, "poll read");
             }
-
-            std::this_thread::sleep_for(std::chrono::milliseconds(interval_ms));
-        } catch (const std::exception& e) {
-            if (error_action == ErrorAction::STOP) throw;
             if (verbose) {
-                std::cout << "Error during polling: " << e.what() << "\n";
+                const PollCondition& condition = spec.conditions[unmet];
+                std::cout << "Polling timeout on 0x" << std::hex << (int)condition.addr
+                          << " register 0x" << (int)condition.reg;
+                if (error < 0) {
+                    std::cout << ": " << std::strerror(-error);
+                } else {
+                    std::cout << ": got 0x" << (int)value;
+                }
+                std::cout << ", expected 0x" << (int)condition.expected
+                          << " (mask: 0x" << (int)condition.mask << ")" << std::dec
+                          << " after " << reads << " reads\n";
             }
             return false;
         }
+
+        // Reads stay on a grid instead of drifting by the read time, with
+        // the step doubling up to the maximum interval. A read that overran
+        // its slot (clock stretching, a slow adapter) moves the grid rather
+        // than firing the missed slots back to back.
+        next_read = std::max(next_read + interval_ns, now);
+        interval_ns = std::min(interval_ns * 2, max_interval_ns);
     }
 }
 
-void I2CPlayer::writeFile(uint8_t addr, uint8_t reg, const std::string& filename) {
+std::vector<uint8_t> I2CPlayer::loadFile(const std::string& filename) {
     std::filesystem::path file_path(filename);
     if (!file_path.is_absolute()) {
         std::filesystem::path csv_path(csv_directory);
@@ -263,70 +243,409 @@ void I2CPlayer::writeFile(uint8_t addr, uint8_t reg, const std::string& filename
     std::vector<uint8_t> data(std::istreambuf_iterator<char>(input_file), {});
 
     if (verbose) {
-        std::cout << "Writing " << data.size() << " bytes from " << file_path << "\n";
+        std::cout << "Loaded " << data.size() << " bytes from " << file_path << "\n";
     }
+    return data;
+}
+
+void I2CPlayer::writeFile(uint8_t addr, uint8_t reg, const std::string& filename) {
+    std::vector<uint8_t> data = loadFile(filename);
 
     for (uint8_t byte : data) {
-        writeByte(addr, reg, byte);
+        checkResult(writeByte(addr, reg, byte), "write");
     }
 }
 
-std::string I2CPlayer::trim(const std::string& str) {
-    size_t first = str.find_first_not_of(" \t\n\r");
-    if (first == std::string::npos) return "";
-    size_t last = str.find_last_not_of(" \t\n\r");
-    return str.substr(first, (last - first + 1));
+int I2CPlayer::waitWriteCycle(uint8_t addr, const uint8_t* word_addr, uint8_t addr_bytes) {
+    // The EEPROM does not acknowledge its address while the internal write
+    // cycle is running, so a dummy write of the word address doubles as a
+    // completion probe and leaves the address pointer where it was. This
+    // runs inside the page write's retry attempt, so --stats charges the
+    // whole tWR wait to that transfer.
+    uint64_t start = monotonicNowNs();
+    int polls = 0;
+
+    while (true) {
+        polls++;
+        int rc = bus->writeBytes(addr, word_addr, addr_bytes);
+        if (rc == 0) {
+            if (verbose) {
+                std::cout << "  write cycle done after " << polls << " poll(s)\n";
+            }
+            return 0;
+        }
+        if (!RetryEngine::isNAK(-rc)) {
+            return rc;
+        }
+
+        if (monotonicNowNs() - start >= EEPROM_WRITE_TIMEOUT_MS * 1000000ull) {
+            return -ETIMEDOUT;
+        }
+        sleepForUs(EEPROM_POLL_INTERVAL_US);
+    }
 }
 
-int I2CPlayer::hexToInt(const std::string& hex) {
-    std::string cleaned = hex;
-    if (cleaned.substr(0, 2) == "0x") {
-        cleaned = cleaned.substr(2);
+void I2CPlayer::writeEEPROMPage(uint8_t addr, const EEPROMGeometry& geometry, size_t offset,
+                                const uint8_t* data, uint16_t len) {
+    uint8_t dev_addr = addr | ((offset >> 8) & ((1 << geometry.block_bits) - 1));
+    std::vector<uint8_t> buf(geometry.addr_bytes + len);
+    if (geometry.addr_bytes == 2) {
+        buf[0] = static_cast<uint8_t>((offset >> 8) & 0xFF);
+        buf[1] = static_cast<uint8_t>(offset & 0xFF);
+    } else {
+        buf[0] = static_cast<uint8_t>(offset & 0xFF);
+    }
+    std::copy(data, data + len, buf.begin() + geometry.addr_bytes);
+
+    int rc = retry.execute(dev_addr, [&]() {
+        int rc = bus->writeBytes(dev_addr, buf.data(), buf.size());
+        if (rc < 0) return rc;
+        return waitWriteCycle(dev_addr, buf.data(), geometry.addr_bytes);
+    });
+
+    if (rc == 0 && verbose) {
+        std::cout << "Page Write: 0x" << std::hex << (int)dev_addr
+                 << " offset:0x" << offset
+                 << std::dec << " len:" << len;
+        printRetries();
     }
-    return std::stoi(cleaned, nullptr, 16);
+    checkResult(rc, "page write");
 }
 
-void I2CPlayer::executeSequence(const std::vector<std::string>& sequence, int iterations) {
+void I2CPlayer::writeEEPROM(uint8_t addr, size_t offset, const std::string& filename,
+                            const EEPROMGeometry& geometry) {
+    std::vector<uint8_t> data = loadFile(filename);
+
+    if (offset + data.size() > geometry.size) {
+        throw std::runtime_error("File does not fit into " + std::string(geometry.name));
+    }
+
+    uint64_t start = monotonicNowNs();
+    size_t pos = 0;
+    size_t pages = 0;
+    while (pos < data.size()) {
+        // A page write wraps around inside the page, so never cross a boundary
+        // and never exceed what the backend can send in one write
+        size_t address = offset + pos;
+        size_t room = geometry.page_size - (address % geometry.page_size);
+        room = std::min(room, bus->maxWriteLength() - geometry.addr_bytes);
+        size_t chunk = std::min(room, data.size() - pos);
+        writeEEPROMPage(addr, geometry, address, data.data() + pos, chunk);
+        pos += chunk;
+        pages++;
+    }
+
     if (verbose) {
-        std::cout << "Starting loop sequence for " << iterations << " iterations\n";
+        uint64_t elapsed_ms = (monotonicNowNs() - start) / 1000000;
+        std::cout << "Programmed " << data.size() << " bytes into " << geometry.name
+                  << " in " << pages << " page writes (" << elapsed_ms << " ms)\n";
     }
+}
 
-    for (int iter = 0; iter < iterations; iter++) {
+int I2CPlayer::readEEPROM(uint8_t addr, const EEPROMGeometry& geometry, size_t offset,
+                          uint8_t* data, size_t len) {
+    if (geometry.addr_bytes == 2 && bus->maxTransferMessages() == 0) {
+        throw std::runtime_error(std::string("Reading a ") + geometry.name +
+                                 " needs an adapter with I2C_RDWR support");
+    }
+
+    size_t pos = 0;
+    while (pos < len) {
+        // Parts with one address byte select each 256-byte block through
+        // the device address, so a read never crosses a block
+        size_t address = offset + pos;
+        size_t chunk = std::min(len - pos, EEPROM_READ_CHUNK - address % EEPROM_READ_CHUNK);
+        uint8_t dev_addr = addr | ((address >> 8) & ((1 << geometry.block_bits) - 1));
+
+        int rc;
+        if (geometry.addr_bytes == 1) {
+            rc = retry.execute(dev_addr, [&]() {
+                return bus->readRegister(dev_addr, address & 0xFF, data + pos, chunk);
+            });
+        } else {
+            uint8_t word_addr[2] = {
+                static_cast<uint8_t>((address >> 8) & 0xFF),
+                static_cast<uint8_t>(address & 0xFF)
+            };
+            struct i2c_msg msgs[2];
+            msgs[0].addr = dev_addr;
+            msgs[0].flags = 0;
+            msgs[0].len = 2;
+            msgs[0].buf = word_addr;
+            msgs[1].addr = dev_addr;
+            msgs[1].flags = I2C_M_RD;
+            msgs[1].len = chunk;
+            msgs[1].buf = data + pos;
+            rc = retry.execute(dev_addr, [&]() { return bus->transfer(msgs, 2); });
+        }
+        if (rc < 0) return rc;
+        pos += chunk;
+    }
+    return 0;
+}
+
+void I2CPlayer::syncEEPROM(uint8_t addr, size_t offset, const std::string& filename,
+                           const EEPROMGeometry& geometry) {
+    std::vector<uint8_t> data = loadFile(filename);
+
+    if (offset + data.size() > geometry.size) {
+        throw std::runtime_error("File does not fit into " + std::string(geometry.name));
+    }
+
+    uint64_t start = monotonicNowNs();
+    std::vector<uint8_t> current(data.size());
+    int rc = readEEPROM(addr, geometry, offset, current.data(), current.size());
+    checkResult(rc, "EEPROM read");
+    if (rc < 0) return;
+    uint64_t read_done = monotonicNowNs();
+
+    // Pages are split exactly as writeEEPROM() splits them
+    size_t skipped = 0;
+    size_t bytes_skipped = 0;
+    size_t bytes_written = 0;
+    std::vector<std::pair<size_t, size_t>> written;     // [begin, end) within data
+    size_t pos = 0;
+    while (pos < data.size()) {
+        size_t address = offset + pos;
+        size_t room = geometry.page_size - (address % geometry.page_size);
+        room = std::min(room, bus->maxWriteLength() - geometry.addr_bytes);
+        size_t chunk = std::min(room, data.size() - pos);
+
+        // Most pages are expected to match, and memcmp compares them a
+        // vector register at a time
+        if (std::memcmp(current.data() + pos, data.data() + pos, chunk) != 0) {
+            // A page write only needs the span between the first and last
+            // changed byte
+            size_t begin = pos;
+            size_t end = pos + chunk;
+            while (current[begin] == data[begin]) begin++;
+            while (current[end - 1] == data[end - 1]) end--;
+            writeEEPROMPage(addr, geometry, offset + begin, data.data() + begin, end - begin);
+            bytes_written += end - begin;
+            written.emplace_back(begin, end);
+        } else {
+            skipped++;
+            bytes_skipped += chunk;
+        }
+        pos += chunk;
+    }
+    uint64_t write_done = monotonicNowNs();
+
+    // Unchanged pages were just compared against the device, so only the
+    // written spans are read again
+    for (const auto& span : written) {
+        rc = readEEPROM(addr, geometry, offset + span.first, current.data() + span.first,
+                        span.second - span.first);
+        checkResult(rc, "EEPROM verify read");
+        if (rc < 0) return;
+        auto diff = std::mismatch(data.begin() + span.first, data.begin() + span.second,
+                                  current.begin() + span.first);
+        if (diff.first != data.begin() + span.second) {
+            std::stringstream message;
+            message << geometry.name << " verify failed at offset 0x" << std::hex
+                    << offset + (diff.first - data.begin()) << ": wrote 0x" << (int)*diff.first
+                    << ", read 0x" << (int)*diff.second;
+            throw std::runtime_error(message.str());
+        }
+    }
+    uint64_t end = monotonicNowNs();
+
+    std::cout << std::fixed << std::setprecision(1)
+              << "SYNC " << geometry.name << " 0x" << std::hex << (int)addr << std::dec
+              << ": skipped " << skipped << " unchanged pages (" << bytes_skipped
+              << " bytes), wrote and verified " << written.size() << " pages ("
+              << bytes_written << " bytes) in " << (end - start) / 1000000.0
+              << " ms (read " << (read_done - start) / 1000000.0
+              << ", write " << (write_done - read_done) / 1000000.0
+              << ", verify " << (end - write_done) / 1000000.0 << ")\n";
+    std::cout.unsetf(std::ios::floatfield);
+}
+
+int I2CPlayer::calibrate(uint8_t addr, const std::string& device) {
+    auto parser = parsers.find(device);
+    if (parser == parsers.end()) {
+        throw std::runtime_error("No parser found for device: " + device);
+    }
+    CalibrationBlock block = parser->second->calibrationBlock();
+    if (block.len == 0) {
+        throw std::runtime_error(device + " has no calibration block");
+    }
+
+    const std::vector<uint8_t>* cached = calibrations.find(device, bus->device(), addr);
+    if (cached && parser->second->setCalibration(*cached)) {
         if (verbose) {
-            std::cout << "Loop iteration " << (iter + 1) << "/" << iterations << "\n";
+            std::cout << "Using cached " << device << " calibration for 0x"
+                      << std::hex << (int)addr << std::dec << "\n";
         }
+        return 0;
+    }
 
-        for (const auto& line : sequence) {
-            std::stringstream ss(line);
-            std::string token;
-            std::vector<std::string> tokens;
+    // One burst read of the whole block
+    std::vector<uint8_t> data(block.len);
+    int rc = readBlock(addr, block.reg, data.data(), block.len);
+    if (rc < 0) return rc;
+    if (!parser->second->setCalibration(data)) {
+        throw std::runtime_error("Invalid " + device + " calibration data");
+    }
+    calibrations.store(device, bus->device(), addr, data);
+    return 0;
+}
 
-            while (std::getline(ss, token, ',')) {
-                tokens.push_back(trim(token));
-            }
+static bool isBusRead(OpCode op) {
+    return op == OpCode::READ || op == OpCode::READN || op == OpCode::READBLOCK ||
+           op == OpCode::POLL || op == OpCode::CALIBRATE;
+}
 
-            if (tokens.empty()) continue;
+static bool isBusWrite(OpCode op) {
+    return op == OpCode::WRITE || op == OpCode::WRITE1 ||
+           op == OpCode::WRITE16 || op == OpCode::FILE || op == OpCode::SYNC;
+}
 
-            std::string cmd = tokens[0];
-            
-            try {
-                if (cmd == "WRITE1") {
-                    if (tokens.size() != 3) throw std::runtime_error("Invalid WRITE1 format");
-                    uint8_t addr = hexToInt(tokens[1]);
-                    uint8_t data = hexToInt(tokens[2]);
-                    writeSingleByte(addr, data);
-                }
-                else if (cmd == "DELAY") {
-                    if (tokens.size() != 2) throw std::runtime_error("Invalid DELAY format");
-                    int delay = std::stoi(tokens[1]);
-                    std::this_thread::sleep_for(std::chrono::milliseconds(delay));
+void I2CPlayer::executeInstruction(const Program& program, const Instruction& ins) {
+    bool bus_op = isBusRead(ins.op) || isBusWrite(ins.op);
+    if (bus_op && gaps.configured()) {
+        LatencyStats::Scope sleep(latency, TimeCategory::SLEEP);
+        gaps.beforeTransaction(ins.addr, isBusRead(ins.op));
+    }
+
+    LatencyStats::CommandScope command(latency, static_cast<size_t>(ins.op),
+                                       bus_op ? ins.addr : -1);
+
+    switch (ins.op) {
+        case OpCode::WRITE:
+            checkResult(writeByte(ins.addr, ins.reg, static_cast<uint8_t>(ins.data)), "write");
+            break;
+        case OpCode::WRITE1:
+            checkResult(writeSingleByte(ins.addr, static_cast<uint8_t>(ins.data)), "write");
+            break;
+        case OpCode::WRITE16:
+            checkResult(write16Bit(ins.addr, ins.reg, ins.data), "16-bit write");
+            break;
+        case OpCode::READ: {
+            uint8_t data = 0;
+            int rc = readByte(ins.addr, ins.reg, data);
+            checkResult(rc, "register read");
+            if (rc == 0 && recording && record_buffer.size() < record_buffer.capacity()) {
+                record_buffer.push_back(data);
+            }
+            break;
+        }
+        case OpCode::READN: {
+            // The transfer always reads the full length; only the number of
+            // bytes kept is clamped to what is left of the record storage.
+            size_t len = static_cast<size_t>(ins.arg0);
+            size_t offset = record_buffer.size();
+            size_t count = recording ? std::min(len, record_buffer.capacity() - offset) : 0;
+            if (count == len) {
+                // Burst straight into the reserved record storage
+                record_buffer.resize(offset + count);
+                int rc = readBlock(ins.addr, ins.reg, record_buffer.data() + offset, len);
+                if (rc < 0) {
+                    record_buffer.resize(offset);
                 }
-                
-                std::this_thread::sleep_for(std::chrono::milliseconds(i2c_wait_ms));
-            } catch (const std::exception& e) {
-                if (error_action == ErrorAction::STOP) throw;
-                std::cerr << "Error in loop sequence: " << e.what() << "\n";
+                checkResult(rc, "block read");
+                break;
+            }
+            if (read_scratch.size() < len) {
+                read_scratch.resize(len);
+            }
+            int rc = readBlock(ins.addr, ins.reg, read_scratch.data(), len);
+            if (rc == 0) {
+                record_buffer.insert(record_buffer.end(), read_scratch.begin(),
+                                     read_scratch.begin() + count);
+            }
+            checkResult(rc, "block read");
+            break;
+        }
+        case OpCode::READBLOCK: {
+            uint8_t block[I2C_SMBUS_BLOCK_MAX];
+            uint8_t len = 0;
+            int rc = readBlockData(ins.addr, ins.reg, block, len);
+            checkResult(rc, "SMBus block read");
+            if (rc == 0 && recording) {
+                size_t count = std::min(static_cast<size_t>(len),
+                                        record_buffer.capacity() - record_buffer.size());
+                record_buffer.insert(record_buffer.end(), block, block + count);
+            }
+            break;
+        }
+        case OpCode::POLL:
+            if (!poll(program.polls[ins.arg0], poll_stats[ins.arg0])) {
+                throw std::runtime_error("Polling timeout");
+            }
+            break;
+        case OpCode::DELAY: {
+            LatencyStats::Scope sleep(latency, TimeCategory::SLEEP);
+            sleepForUs(ins.arg0);
+            break;
+        }
+        case OpCode::SYNC:
+            syncEEPROM(ins.addr, ins.data, program.strings[ins.arg0],
+                       EEPROM_GEOMETRIES[ins.arg1 - 1]);
+            break;
+        case OpCode::FILE:
+            if (ins.arg1 > 0 && eeprom_sync) {
+                syncEEPROM(ins.addr, ins.data, program.strings[ins.arg0],
+                           EEPROM_GEOMETRIES[ins.arg1 - 1]);
+            } else if (ins.arg1 > 0) {
+                writeEEPROM(ins.addr, ins.data, program.strings[ins.arg0],
+                            EEPROM_GEOMETRIES[ins.arg1 - 1]);
+            } else {
+                writeFile(ins.addr, ins.reg, program.strings[ins.arg0]);
             }
+            break;
+        case OpCode::CALIBRATE:
+            checkResult(calibrate(ins.addr, program.strings[ins.arg0]), "calibration read");
+            break;
+        case OpCode::START_RECORD:
+            record_buffer.clear();
+            record_buffer.reserve(ins.arg0);
+            recording = true;
+            return;
+        case OpCode::STOP_RECORD:
+            recording = false;
+            return;
+        case OpCode::PRINT_RECORD: {
+            LatencyStats::Scope decode(latency, TimeCategory::DECODE);
+            printRecord(program.strings[ins.arg0]);
+            return;
+        }
+        case OpCode::LOOP:
+        case OpCode::LOOP_EVERY:
+        case OpCode::SAMPLE:
+        case OpCode::ENDLOOP:
+            return;
+    }
+
+    // With device profiles the gaps are inserted before the next
+    // transaction; otherwise fall back to the global wait after each command
+    command.finish();
+    if (gaps.configured()) {
+        if (bus_op) {
+            gaps.afterTransaction(ins.addr, isBusWrite(ins.op));
+        }
+        return;
+    }
+    LatencyStats::Scope sleep(latency, TimeCategory::SLEEP);
+    sleepForUs(i2c_wait_ms * 1000ull);
+}
+
+void I2CPlayer::executeLoop(const Program& program, size_t loop_index) {
+    const Instruction& loop = program.code[loop_index];
+    int iterations = loop.arg0;
+
+    if (verbose) {
+        std::cout << "Starting loop sequence for " << iterations << " iterations\n";
+    }
+
+    if (loop.op == OpCode::LOOP_EVERY || loop.op == OpCode::SAMPLE) {
+        executePeriodicLoop(program, loop_index);
+    } else {
+        for (int iter = 0; iter < iterations; iter++) {
+            if (verbose) {
+                std::cout << "Loop iteration " << (iter + 1) << "/" << iterations << "\n";
+            }
+            executeRange(program, loop_index + 1, loop.jump);
         }
     }
 
@@ -335,191 +654,711 @@ void I2CPlayer::executeSequence(const std::vector<std::string>& sequence, int it
     }
 }
 
-void I2CPlayer::playFile(const std::string& filename) {
-    csv_directory = filename;
-    std::ifstream file(filename);
-    if (!file.is_open()) {
-        throw std::runtime_error("Failed to open input file: " + filename);
-    }
+void I2CPlayer::executePeriodicLoop(const Program& program, size_t loop_index) {
+    const Instruction& loop = program.code[loop_index];
+    int iterations = loop.arg0;
+    uint64_t period_ns = loop.arg1 * 1000ull;
+    bool sample = loop.op == OpCode::SAMPLE;
+    uint16_t device = sample ? sample_devices[loop.data] : 0;
 
-    std::string line;
-    int line_number = 0;
-    bool header_skipped = false;
-    std::vector<std::string> loop_sequence;
-    bool in_loop = false;
-    int loop_count = 0;
+    PeriodStats& stats = loop_stats[loop_index];
 
-    while (std::getline(file, line)) {
-        line_number++;
+    // Iteration k starts at start + k * period, so neither the body's
+    // execution time nor sleep overshoot accumulates across iterations
+    uint64_t start = monotonicNowNs();
+    uint64_t previous = start;
+
+    for (int iter = 0; iter < iterations; iter++) {
+        if (iter > 0) {
+            uint64_t deadline = start + iter * period_ns;
+            if (monotonicNowNs() > deadline) {
+                stats.addOverrun();
+            }
+            {
+                LatencyStats::Scope sleep(latency, TimeCategory::SLEEP);
+                sleepUntilNs(deadline);
+            }
+            uint64_t now = monotonicNowNs();
+            stats.add(now - previous, period_ns);
+            previous = now;
+        }
 
         if (verbose) {
-            std::cout << "DEBUG: Line " << line_number << ": [" << line << "]\n";
+            std::cout << "Loop iteration " << (iter + 1) << "/" << iterations << "\n";
         }
 
-        if (line.empty() || trim(line)[0] == '#') {
-            if (verbose) {
-                std::cout << "DEBUG: Skipping line (empty or comment)\n";
-            }
+        if (!sample) {
+            executeRange(program, loop_index + 1, loop.jump);
             continue;
         }
 
-        if (!header_skipped) {
-            header_skipped = true;
-            if (verbose) {
-                std::cout << "DEBUG: Skipping header line\n";
-            }
-            continue;
+        // Each iteration records one frame; the ring copy is the only work
+        // added to the bus thread, formatting and I/O happen on the writer
+        record_buffer.clear();
+        recording = true;
+        executeRange(program, loop_index + 1, loop.jump);
+        sampler->submit(previous, device, record_buffer.data(), record_buffer.size());
+    }
+
+    if (sample) {
+        recording = false;
+    }
+}
+
+void I2CPlayer::printRecord(const std::string& device) {
+    auto parser = parsers.find(device);
+    if (parser == parsers.end()) {
+        std::cerr << "No parser found for device: " << device << "\n";
+    } else if (output_format == OutputFormat::REPORT) {
+        parser->second->parse(record_buffer);
+    } else if (parser->second->decode(record_buffer, decoded)) {
+        emitter.emit(decoded, monotonicNowNs());
+    } else {
+        std::cerr << "Cannot decode " << record_buffer.size()
+                  << " recorded bytes for device: " << device << "\n";
+    }
+}
+
+void I2CPlayer::readFrame(uint8_t addr, uint8_t reg, uint16_t len, const std::string& device) {
+    record_buffer.resize(len);
+    int rc = readBlock(addr, reg, record_buffer.data(), len);
+    if (rc < 0) {
+        throw std::runtime_error(std::string("frame read failed: ") + std::strerror(-rc));
+    }
+
+    if (!device.empty()) {
+        printRecord(device);
+        return;
+    }
+    std::cout << std::hex << std::setfill('0');
+    for (size_t i = 0; i < record_buffer.size(); i++) {
+        std::cout << (i ? " " : "") << std::setw(2) << (int)record_buffer[i];
+    }
+    std::cout << std::dec << std::setfill(' ') << "\n";
+}
+
+void I2CPlayer::printLoopStats(const Program& program) const {
+    for (size_t pc = 0; pc < program.code.size(); pc++) {
+        auto stats = loop_stats.find(pc);
+        if (stats == loop_stats.end()) continue;
+        std::cout << (program.code[pc].op == OpCode::SAMPLE ? "SAMPLE" : "LOOP_EVERY")
+                  << " at line " << program.code[pc].line << ": ";
+        stats->second.print(std::cout, program.code[pc].arg1);
+    }
+
+    if (verbose || latency.enabled()) {
+        for (const Instruction& ins : program.code) {
+            if (ins.op != OpCode::POLL) continue;
+            auto stats = poll_stats.find(ins.arg0);
+            if (stats == poll_stats.end()) continue;
+            std::cout << "POLL at line " << ins.line << ": ";
+            stats->second.print(std::cout);
         }
+    }
 
-        try {
-            std::stringstream ss(line);
-            std::string token;
-            std::vector<std::string> tokens;
-
-            while (std::getline(ss, token, ',')) {
-                std::string trimmed = trim(token);
-                if (verbose) {
-                    std::cout << "DEBUG: Parsed token: [" << trimmed << "]\n";
-                }
-                tokens.push_back(trimmed);
-            }
+    if (sampler) {
+        std::cout << "SAMPLE frames: " << sampler->captured() << " captured, "
+                  << sampler->written() << " written, "
+                  << sampler->overruns() << " dropped (ring full)\n";
+    }
+}
 
-            if (tokens.empty()) {
-                if (verbose) {
-                    std::cout << "DEBUG: Tokens vector is empty\n";
-                }
-                continue;
-            }
+size_t I2CPlayer::frameSize(const Program& program, size_t begin, size_t end) const {
+    size_t size = 0;
+    for (size_t pc = begin; pc < end; pc++) {
+        const Instruction& ins = program.code[pc];
+        switch (ins.op) {
+            case OpCode::READ:      size += 1; break;
+            case OpCode::READN:     size += ins.arg0; break;
+            case OpCode::READBLOCK: size += I2C_SMBUS_BLOCK_MAX; break;
+            case OpCode::LOOP:
+            case OpCode::LOOP_EVERY:
+            case OpCode::SAMPLE:
+                size += frameSize(program, pc + 1, ins.jump) * std::max(ins.arg0, 0);
+                pc = ins.jump;
+                break;
+            default:
+                break;
+        }
+    }
+    return size;
+}
 
-            std::string cmd = tokens[0];
-            if (verbose) {
-                std::cout << "DEBUG: Command: [" << cmd << "]\n";
-            }
+void I2CPlayer::setSampleOutput(const std::string& path, SampleFormat format, size_t ring_frames) {
+    sample_path = path;
+    sample_format = format;
+    sample_ring_frames = ring_frames;
+}
 
-            if (cmd == "LOOP") {
-                if (tokens.size() != 2) throw std::runtime_error("Invalid LOOP format");
-                if (in_loop) throw std::runtime_error("Nested loops not supported");
-                in_loop = true;
-                loop_count = std::stoi(tokens[1]);
-                loop_sequence.clear();
-                continue;
-            }
-            else if (cmd == "ENDLOOP") {
-                if (!in_loop) throw std::runtime_error("ENDLOOP without LOOP");
-                in_loop = false;
-                if (verbose) {
-                    std::cout << "Executing loop " << loop_count << " times\n";
-                }
-                executeSequence(loop_sequence, loop_count);
-                continue;
-            }
+void I2CPlayer::setCalibrationCache(const std::string& path) {
+    calibrations.setFile(path);
+}
 
-            if (cmd == "START_RECORD") {
-                if (tokens.size() != 2) throw std::runtime_error("Invalid START_RECORD format");
-                int buffer_size = std::stoi(tokens[1]);
-                record_buffer.clear();
-                record_buffer.reserve(buffer_size);
-                recording = true;
-                continue;
-            }
-            else if (cmd == "STOP_RECORD") {
-                recording = false;
-                continue;
+void I2CPlayer::setInventory(const std::string& path) {
+    inventory.setFile(path);
+}
+
+void I2CPlayer::setEEPROMSync(bool enable) {
+    eeprom_sync = enable;
+}
+
+void I2CPlayer::checkInventory(const Program& program) const {
+    if (!inventory.scanned(bus->device())) return;
+
+    std::bitset<128> checked;
+    auto check = [&](uint8_t addr, int line) {
+        if (checked.test(addr)) return;
+        checked.set(addr);
+        if (inventory.find(bus->device(), addr)) return;
+
+        std::stringstream message;
+        message << "No device at 0x" << std::hex << (int)addr << std::dec << " (line " << line
+                << ") in the last scan of " << bus->device() << " (" << inventory.file()
+                << "); rescan with --scan or disable the check with --inventory=none";
+        // CONTINUE skips absent devices anyway, so only warn
+        if (error_action == ErrorAction::CONTINUE) {
+            std::cerr << "Warning: " << message.str() << "\n";
+            return;
+        }
+        throw std::runtime_error(message.str());
+    };
+
+    for (const Instruction& ins : program.code) {
+        if (ins.op == OpCode::POLL) {
+            const PollSpec& spec = program.polls[ins.arg0];
+            for (size_t i = 0; i < spec.condition_count; i++) {
+                check(spec.conditions[i].addr, ins.line);
             }
-            else if (cmd == "PRINT_RECORD") {
-                if (tokens.size() != 2) throw std::runtime_error("Invalid PRINT_RECORD format");
-                auto parser = parsers.find(tokens[1]);
-                if (parser != parsers.end()) {
-                    parser->second->parse(record_buffer);
-                } else {
-                    std::cerr << "No parser found for device: " << tokens[1] << "\n";
+        } else if (isBusRead(ins.op) || isBusWrite(ins.op)) {
+            check(ins.addr, ins.line);
+        }
+    }
+}
+
+void I2CPlayer::setOutputFormat(OutputFormat format) {
+    output_format = format;
+    emitter.setFormat(format);
+}
+
+void I2CPlayer::startSampler(const Program& program) {
+    // Size every ring slot and the record buffer for the largest frame up
+    // front so sampling never allocates
+    std::vector<std::string> devices;
+    size_t max_frame = 0;
+    sample_devices.assign(program.strings.size(), 0);
+    for (size_t pc = 0; pc < program.code.size(); pc++) {
+        const Instruction& ins = program.code[pc];
+        if (ins.op != OpCode::SAMPLE) continue;
+
+        size_t frame = frameSize(program, pc + 1, ins.jump);
+        if (frame > 0xFFFF) {
+            throw std::runtime_error("SAMPLE frame at line " + std::to_string(ins.line) +
+                                     " exceeds 65535 bytes");
+        }
+        max_frame = std::max(max_frame, frame);
+
+        const std::string& name = program.strings[ins.data];
+        auto known = std::find(devices.begin(), devices.end(), name);
+        sample_devices[ins.data] = known - devices.begin();
+        if (known == devices.end()) {
+            devices.push_back(name);
+        }
+    }
+
+    if (devices.empty()) return;
+
+    record_buffer.clear();
+    record_buffer.reserve(max_frame);
+    sampler = std::make_unique<SampleWriter>(sample_path, sample_format, sample_ring_frames,
+                                             max_frame, devices);
+}
+
+void I2CPlayer::finishSampler() {
+    if (sampler) {
+        sampler->finish();
+    }
+}
+
+static bool isBatchable(OpCode op) {
+    switch (op) {
+        case OpCode::WRITE:
+        case OpCode::WRITE1:
+        case OpCode::WRITE16:
+        case OpCode::READ:
+        case OpCode::READN:
+            return true;
+        default:
+            return false;
+    }
+}
+
+static int batchMessages(const Instruction& ins) {
+    return (ins.op == OpCode::READ || ins.op == OpCode::READN) ? 2 : 1;
+}
+
+void I2CPlayer::setBatchMode(bool enable) {
+    if (enable && bus->maxTransferMessages() < 2) {
+        std::cerr << "Bus backend cannot combine messages, batching disabled\n";
+        enable = false;
+    }
+    batch_mode = enable;
+}
+
+void I2CPlayer::planBatches(const Program& program) {
+    // batch_ends[pc] is the end of the longest batchable run starting at pc.
+    // LOOP/ENDLOOP and every command with timing or data dependencies end a
+    // run, so batches never cross a loop boundary. Gaps are only enforced
+    // around a whole batch, so a command for a device with a TIMING gap is
+    // never merged and runs on its own.
+    int max_msgs = bus->maxTransferMessages();
+    bool gapped = gaps.configured();
+    batch_ends.assign(program.code.size(), 0);
+    for (size_t pc = 0; pc < program.code.size(); pc++) {
+        size_t end = pc;
+        int msgs = 0;
+        while (end < program.code.size() && isBatchable(program.code[end].op)) {
+            if (gapped && gaps.needsGap(program.code[end].addr)) break;
+            int n = batchMessages(program.code[end]);
+            if (msgs + n > max_msgs) break;
+            msgs += n;
+            end++;
+        }
+        batch_ends[pc] = end;
+    }
+}
+
+void I2CPlayer::executeBatch(const Program& program, size_t begin, size_t end) {
+    // Size the payload area first so message buffers can point into it
+    size_t bytes = 0;
+    for (size_t pc = begin; pc < end; pc++) {
+        const Instruction& ins = program.code[pc];
+        switch (ins.op) {
+            case OpCode::WRITE:   bytes += 2; break;
+            case OpCode::WRITE1:  bytes += 1; break;
+            case OpCode::WRITE16: bytes += 3; break;
+            case OpCode::READ:    bytes += 2; break;
+            case OpCode::READN:   bytes += 1 + ins.arg0; break;
+            default: break;
+        }
+    }
+    batch_bytes.resize(bytes);
+    batch_msgs.clear();
+
+    size_t record_mark = record_buffer.size();
+    uint8_t* p = batch_bytes.data();
+
+    // At most one read can straddle the end of the record storage
+    const uint8_t* clamped_src = nullptr;
+    size_t clamped_offset = 0;
+    size_t clamped_count = 0;
+
+    for (size_t pc = begin; pc < end; pc++) {
+        const Instruction& ins = program.code[pc];
+        struct i2c_msg msg;
+        msg.addr = ins.addr;
+        msg.flags = 0;
+        msg.len = 0;
+        msg.buf = p;
+
+        switch (ins.op) {
+            case OpCode::WRITE:
+                p[0] = ins.reg;
+                p[1] = static_cast<uint8_t>(ins.data);
+                msg.len = 2;
+                break;
+            case OpCode::WRITE1:
+                p[0] = static_cast<uint8_t>(ins.data);
+                msg.len = 1;
+                break;
+            case OpCode::WRITE16:
+                p[0] = ins.reg;
+                p[1] = static_cast<uint8_t>(ins.data & 0xFF);
+                p[2] = static_cast<uint8_t>((ins.data >> 8) & 0xFF);
+                msg.len = 3;
+                break;
+            case OpCode::READ:
+            case OpCode::READN: {
+                p[0] = ins.reg;
+                msg.len = 1;
+                batch_msgs.push_back(msg);
+
+                // Reads land in the record buffer while recording, which was
+                // reserved by START_RECORD and therefore never reallocates here
+                uint16_t len = (ins.op == OpCode::READ) ? 1 : ins.arg0;
+                struct i2c_msg rd;
+                rd.addr = ins.addr;
+                rd.flags = I2C_M_RD;
+                rd.len = len;
+                rd.buf = p + 1;
+                if (recording) {
+                    size_t offset = record_buffer.size();
+                    size_t count = std::min(static_cast<size_t>(len),
+                                            record_buffer.capacity() - offset);
+                    record_buffer.resize(offset + count);
+                    if (count == len) {
+                        rd.buf = record_buffer.data() + offset;
+                    } else if (count > 0) {
+                        // The read keeps its full length; the kept prefix is
+                        // copied once the transfer has succeeded
+                        clamped_src = rd.buf;
+                        clamped_offset = offset;
+                        clamped_count = count;
+                    }
                 }
+                p += 1 + len;
+                batch_msgs.push_back(rd);
                 continue;
             }
+            default:
+                break;
+        }
+        p += msg.len;
+        batch_msgs.push_back(msg);
+    }
+
+    if (gaps.configured()) {
+        LatencyStats::Scope sleep(latency, TimeCategory::SLEEP);
+        gaps.beforeTransaction(program.code[begin].addr, isBusRead(program.code[begin].op));
+    }
 
-            if (in_loop) {
-                loop_sequence.push_back(line);
+    // The whole run counts as one BATCH command
+    LatencyStats::CommandScope command(latency, OPCODE_COUNT, -1);
+    int rc;
+    {
+        LatencyStats::Scope transfer(latency, TimeCategory::BUS);
+        rc = bus->transfer(batch_msgs.data(), batch_msgs.size());
+    }
+    if (rc < 0) {
+        // The kernel does not report which message failed, and the messages
+        // before it may already have reached their devices. Replaying them
+        // would repeat writes (FIFO pushes, page writes, command registers),
+        // so the run fails as one unit under the error action instead.
+        record_buffer.resize(record_mark);
+        command.finish();
+        std::string message = "Batch of " + std::to_string(batch_msgs.size()) + " messages failed: " +
+                              std::strerror(-rc) + "; not replayed, earlier messages may have been sent";
+        std::cerr << "Error at lines " << program.code[begin].line << "-"
+                  << program.code[end - 1].line << ": " << message << "\n";
+        if (error_action == ErrorAction::STOP) {
+            throw std::runtime_error(message);
+        }
+        return;
+    }
+
+    if (clamped_src) {
+        std::memcpy(record_buffer.data() + clamped_offset, clamped_src, clamped_count);
+    }
+
+    if (verbose) {
+        std::cout << "Batch: " << batch_msgs.size() << " messages, lines "
+                  << program.code[begin].line << "-" << program.code[end - 1].line << "\n";
+    }
+
+    command.finish();
+    if (gaps.configured()) {
+        const Instruction& last = program.code[end - 1];
+        gaps.afterTransaction(last.addr, isBusWrite(last.op));
+        return;
+    }
+    LatencyStats::Scope sleep(latency, TimeCategory::SLEEP);
+    sleepForUs(i2c_wait_ms * 1000ull);
+}
+
+void I2CPlayer::executeRange(const Program& program, size_t begin, size_t end) {
+    for (size_t pc = begin; pc < end; pc++) {
+        const Instruction& ins = program.code[pc];
+
+        if (ins.op == OpCode::LOOP || ins.op == OpCode::LOOP_EVERY || ins.op == OpCode::SAMPLE) {
+            executeLoop(program, pc);
+            pc = ins.jump;
+            continue;
+        }
+
+        if (batch_mode) {
+            size_t batch_end = std::min(static_cast<size_t>(batch_ends[pc]), end);
+            if (batch_end > pc + 1) {
+                executeBatch(program, pc, batch_end);
+                pc = batch_end - 1;
                 continue;
             }
+        }
 
-            if (cmd == "WRITE") {
-                if (tokens.size() != 4) throw std::runtime_error("Invalid WRITE format");
-                uint8_t addr = hexToInt(tokens[1]);
-                uint8_t reg = hexToInt(tokens[2]);
-                uint8_t data = hexToInt(tokens[3]);
-                writeByte(addr, reg, data);
-            }
-            else if (cmd == "WRITE1") {
-                if (tokens.size() != 3) throw std::runtime_error("Invalid WRITE1 format");
-                uint8_t addr = hexToInt(tokens[1]);
-                uint8_t data = hexToInt(tokens[2]);
-                writeSingleByte(addr, data);
-            }
-            else if (cmd == "WRITE16") {
-                if (verbose) {
-                    std::cout << "DEBUG: Entering WRITE16 processing\n";
-                }
-                if (tokens.size() != 4) {
-                    if (verbose) {
-                        std::cout << "DEBUG: Invalid WRITE16 format\n";
-                    }
-                    throw std::runtime_error("Invalid WRITE16 format");
-                }
-                uint8_t addr = hexToInt(tokens[1]);
-                uint8_t reg = hexToInt(tokens[2]);
-                uint16_t data = hexToInt(tokens[3]);
-                if (verbose) {
-                    std::cout << "DEBUG: WRITE16 parameters:"
-                             << " addr=0x" << std::hex << (int)addr
-                             << " reg=0x" << (int)reg
-                             << " data=0x" << data << std::dec << "\n";
-                }
-                write16Bit(addr, reg, data);
-            }
-            else if (cmd == "READ") {
-                if (tokens.size() != 3) throw std::runtime_error("Invalid READ format");
-                uint8_t addr = hexToInt(tokens[1]);
-                uint8_t reg = hexToInt(tokens[2]);
-                uint8_t data = readByte(addr, reg);
-
-                if (recording && record_buffer.size() < record_buffer.capacity()) {
-                    record_buffer.push_back(data);
-                }
+        try {
+            executeInstruction(program, ins);
+        } catch (const std::exception& e) {
+            std::cerr << "Error at line " << ins.line << ": " << e.what() << "\n";
+            if (error_action == ErrorAction::STOP) throw;
+        }
+    }
+}
+
+void I2CPlayer::beginRun(const Program& program) {
+    loop_stats.clear();
+    poll_stats.clear();
+
+    DeviceTiming fallback;
+    fallback.bus_free_us = i2c_wait_ms * 1000;
+    gaps.setDefault(fallback);
+    // TIMING lines apply to their own run only, a daemon serves many
+    gaps.resetProfiles();
+    for (const auto& profile : program.timings) {
+        gaps.setProfile(profile.first, profile.second);
+    }
+    gaps.reset();
+    if (latency.enabled() && stats_start_ns == 0) {
+        latency.reset();
+        stats_start_ns = monotonicNowNs();
+    }
+    sampler.reset();
+}
+
+void I2CPlayer::executeProgram(const Program& program) {
+    csv_directory = program.source;
+    if (batch_mode) {
+        planBatches(program);
+    }
+    executeRange(program, 0, program.code.size());
+}
+
+void I2CPlayer::endRun() {
+    printLatencyStats();
+
+    if (verbose) {
+        printStats();
+    } else if (retry.hasErrors()) {
+        retry.printStats(std::cout);
+    }
+}
+
+void I2CPlayer::run(const Program& program) {
+    checkInventory(program);
+    beginRun(program);
+    startSampler(program);
+    try {
+        executeProgram(program);
+    } catch (...) {
+        finishSampler();
+        stats_start_ns = 0;
+        throw;
+    }
+    finishSampler();
+    printLoopStats(program);
+    endRun();
+}
+
+void I2CPlayer::playStream(const std::string& path) {
+    ScriptStream stream(path, verbose, error_action);
+    beginRun(Program());
+    try {
+        while (std::unique_ptr<Program> block = stream.next()) {
+            for (const auto& profile : block->timings) {
+                gaps.setProfile(profile.first, profile.second);
             }
-            else if (cmd == "POLL") {
-                if (tokens.size() != 7) throw std::runtime_error("Invalid POLL format");
-                uint8_t addr = hexToInt(tokens[1]);
-                uint8_t reg = hexToInt(tokens[2]);
-                uint8_t mask = hexToInt(tokens[3]);
-                uint8_t expected = hexToInt(tokens[4]);
-                int timeout = std::stoi(tokens[5]);
-                int interval = std::stoi(tokens[6]);
-                if (!pollRegister(addr, reg, mask, expected, timeout, interval)) {
-                    throw std::runtime_error("Polling timeout");
+            // Sample output is set up once for all SAMPLE blocks of a run,
+            // which needs the whole script
+            for (const Instruction& ins : block->code) {
+                if (ins.op == OpCode::SAMPLE) {
+                    throw std::runtime_error("SAMPLE at line " + std::to_string(ins.line) +
+                                             " is not supported in streamed scripts");
                 }
             }
-            else if (cmd == "DELAY") {
-                if (tokens.size() != 2) throw std::runtime_error("Invalid DELAY format");
-                int delay = std::stoi(tokens[1]);
-                std::this_thread::sleep_for(std::chrono::milliseconds(delay));
-            }
-            else if (cmd == "FILE") {
-                if (tokens.size() != 4) throw std::runtime_error("Invalid FILE format");
-                uint8_t addr = hexToInt(tokens[1]);
-                uint8_t reg = hexToInt(tokens[2]);
-                writeFile(addr, reg, tokens[3]);
-            }
-            else {
-                throw std::runtime_error("Unknown command: " + cmd);
+            checkInventory(*block);
+            executeProgram(*block);
+            // Loop statistics are indexed by position within the block
+            printLoopStats(*block);
+            loop_stats.clear();
+            poll_stats.clear();
+        }
+    } catch (...) {
+        stats_start_ns = 0;
+        throw;
+    }
+    endRun();
+}
+
+void I2CPlayer::setBackoff(BackoffPolicy policy, uint32_t base_us) {
+    retry.setBackoff(policy, base_us);
+}
+
+void I2CPlayer::setKernelRetries(bool offload, int timeout_ms) {
+    int kernel_retries = offload ? retry.retries() : -1;
+    int rc = bus->configureAdapter(kernel_retries, timeout_ms);
+    if (rc < 0) {
+        std::cerr << "Failed to configure adapter retries/timeout: " << std::strerror(-rc) << "\n";
+        return;
+    }
+    if (offload) {
+        // The adapter now retries internally; retrying again here would
+        // multiply the attempts
+        retry.setRetries(0);
+    }
+}
+
+void I2CPlayer::setStats(bool enable) {
+    if (enable) {
+        // One histogram per opcode plus one for combined batches
+        latency.enable(OPCODE_COUNT + 1);
+    } else {
+        latency.disable();
+    }
+    retry.setLatencyStats(enable ? &latency : nullptr);
+}
+
+void I2CPlayer::printLatencyStats() {
+    if (!latency.enabled()) return;
+
+    const char* names[OPCODE_COUNT + 1];
+    for (size_t op = 0; op < OPCODE_COUNT; op++) {
+        names[op] = opCodeName(static_cast<OpCode>(op));
+    }
+    names[OPCODE_COUNT] = "BATCH";
+    latency.print(std::cout, names, monotonicNowNs() - stats_start_ns);
+    stats_start_ns = 0;
+}
+
+void I2CPlayer::printStats() const {
+    bus->printStats(std::cout);
+    retry.printStats(std::cout);
+}
+
+void I2CPlayer::loadTimingFile(const std::string& filename) {
+    gaps.loadFile(filename);
+}
+
+void I2CPlayer::playFile(const std::string& filename) {
+    std::error_code ec;
+    if (filename == "-" ||
+        (std::filesystem::exists(filename, ec) && !std::filesystem::is_regular_file(filename, ec))) {
+        playStream(filename);
+        return;
+    }
+
+    if (latency.enabled()) {
+        latency.reset();
+        stats_start_ns = monotonicNowNs();
+    }
+
+    ScriptCompiler compiler(verbose, error_action);
+    Program program;
+    {
+        LatencyStats::Scope compile(latency, TimeCategory::COMPILE);
+        program = compiler.compileFile(filename);
+    }
+    run(program);
+}
+
+// Issue one traced transaction again; read data lands in scratch
+static int replayRecord(I2CBus& bus, const TraceRecord& record, const uint8_t* payload,
+                        std::vector<uint8_t>& scratch, std::vector<struct i2c_msg>& msgs) {
+    switch (record.kind) {
+        case TraceKind::READ_REGISTER:
+            scratch.resize(record.len);
+            return bus.readRegister(record.addr, record.reg, scratch.data(), record.len);
+        case TraceKind::WRITE_REGISTER:
+            return bus.writeRegister(record.addr, record.reg, payload, record.len);
+        case TraceKind::WRITE_BYTES:
+            return bus.writeBytes(record.addr, payload, record.len);
+        case TraceKind::READ_BLOCK_DATA: {
+            scratch.resize(I2C_SMBUS_BLOCK_MAX);
+            uint8_t len = 0;
+            int rc = bus.readBlockData(record.addr, record.reg, scratch.data(), &len);
+            scratch.resize(rc == 0 ? len : 0);
+            return rc;
+        }
+        case TraceKind::TRANSFER: {
+            // Write data is sent from the trace, read data collects in scratch
+            // in message order so it can be compared with the payload. The
+            // headers come from the file, so a corrupt count or length must
+            // not walk past the record.
+            scratch.assign(payload, payload + record.len);
+            msgs.resize(record.messages);
+            uint8_t* p = scratch.data();
+            size_t remaining = scratch.size();
+            for (auto& msg : msgs) {
+                uint16_t header[3];
+                if (remaining < sizeof(header)) return -EINVAL;
+                std::memcpy(header, p, sizeof(header));
+                if (remaining - sizeof(header) < header[2]) return -EINVAL;
+                msg.addr = header[0];
+                msg.flags = header[1];
+                msg.len = header[2];
+                msg.buf = p + sizeof(header);
+                p += sizeof(header) + msg.len;
+                remaining -= sizeof(header) + msg.len;
             }
-            std::this_thread::sleep_for(std::chrono::milliseconds(i2c_wait_ms));
-        } catch (const std::exception& e) {
-            std::cerr << "Error at line " << line_number << ": " << e.what() << "\n";
-            if (error_action == ErrorAction::STOP) throw;
+            if (remaining != 0) return -EINVAL;
+            return bus.transfer(msgs.data(), msgs.size());
         }
+        case TraceKind::PROBE:
+            scratch.clear();
+            return bus.probe(record.addr);
+        case TraceKind::END:
+            break;
     }
+    return -EINVAL;
+}
+
+static bool isTraceRead(const TraceRecord& record) {
+    return record.kind == TraceKind::READ_REGISTER || record.kind == TraceKind::READ_BLOCK_DATA ||
+           record.kind == TraceKind::TRANSFER;
+}
 
-    if (in_loop) {
-        throw std::runtime_error("Unterminated LOOP in CSV");
+void I2CPlayer::replayTrace(const std::string& filename, bool original_timing) {
+    TraceReader reader(filename);
+    std::vector<uint8_t> scratch;
+    std::vector<struct i2c_msg> msgs;
+
+    size_t transactions = 0;
+    size_t result_diffs = 0;
+    size_t data_diffs = 0;
+    uint64_t traced_bus_ns = 0;
+    uint64_t traced_span_ns = 0;
+    uint64_t replay_bus_ns = 0;
+
+    const TraceRecord* record;
+    const uint8_t* payload;
+    uint64_t origin = monotonicNowNs();
+    while (reader.next(record, payload)) {
+        if (original_timing) {
+            sleepUntilNs(origin + record->timestamp_ns);
+        }
+
+        uint64_t start = monotonicNowNs();
+        int rc = replayRecord(*bus, *record, payload, scratch, msgs);
+        replay_bus_ns += monotonicNowNs() - start;
+
+        transactions++;
+        traced_bus_ns += record->duration_ns;
+        traced_span_ns = record->timestamp_ns + record->duration_ns;
+
+        if (rc != record->result) {
+            result_diffs++;
+        } else if (rc == 0 && isTraceRead(*record) &&
+                   (scratch.size() != record->len ||
+                    std::memcmp(scratch.data(), payload, record->len) != 0)) {
+            data_diffs++;
+        }
+
+        if (verbose) {
+            std::cout << "Replay: +" << record->timestamp_ns / 1000 << " us kind "
+                      << static_cast<int>(record->kind) << " addr 0x" << std::hex
+                      << (int)record->addr << std::dec << " len " << record->len
+                      << " result " << rc << " (traced " << record->result << ")\n";
+        }
+    }
+    uint64_t elapsed = monotonicNowNs() - origin;
+
+    std::cout << std::fixed << std::setprecision(3)
+              << "Replayed " << transactions << " transactions in " << elapsed / 1e6
+              << " ms (" << (original_timing ? "original timing" : "max speed")
+              << "), bus " << replay_bus_ns / 1e6 << " ms\n"
+              << "Traced run: " << traced_span_ns / 1e6 << " ms, bus " << traced_bus_ns / 1e6
+              << " ms (" << std::setprecision(1)
+              << (traced_span_ns ? 100.0 * traced_bus_ns / traced_span_ns : 0.0) << "%)\n"
+              << "Differences: " << result_diffs << " results, " << data_diffs << " read data\n";
+    std::cout.unsetf(std::ios::floatfield);
+
+    if (verbose) {
+        printStats();
     }
 }
@@ -0,0 +1,42 @@
+#include "latency_histogram.hpp"
+#include <algorithm>
+#include <cmath>
+
+size_t LatencyHistogram::bucketIndex(uint64_t ns) {
+    if (ns < SUB_BUCKETS) return ns;
+
+    int magnitude = 63 - __builtin_clzll(ns);
+    if (magnitude > MAX_MAGNITUDE) return BUCKETS - 1;
+    int shift = magnitude - SUB_BITS;
+    size_t sub = (ns >> shift) & (SUB_BUCKETS - 1);
+    return (shift + 1) * SUB_BUCKETS + sub;
+}
+
+uint64_t LatencyHistogram::bucketUpperBound(size_t index) {
+    if (index < SUB_BUCKETS) return index;
+
+    int shift = index / SUB_BUCKETS - 1;
+    uint64_t sub = index % SUB_BUCKETS;
+    return ((SUB_BUCKETS + sub + 1) << shift) - 1;
+}
+
+void LatencyHistogram::record(uint64_t ns) {
+    buckets[bucketIndex(ns)]++;
+    samples++;
+    sum += ns;
+    maximum = std::max(maximum, ns);
+}
+
+uint64_t LatencyHistogram::percentile(double p) const {
+    if (samples == 0) return 0;
+
+    uint64_t target = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(p * samples)));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; i++) {
+        seen += buckets[i];
+        if (seen >= target) {
+            return std::min(bucketUpperBound(i), maximum);
+        }
+    }
+    return maximum;
+}
@@ -0,0 +1,69 @@
+#include "latency_stats.hpp"
+#include <algorithm>
+#include <iomanip>
+
+void LatencyStats::enable(size_t kinds) {
+    commands.assign(kinds, LatencyHistogram());
+    addresses.assign(128, LatencyHistogram());
+    category_ns.fill(0);
+    active = true;
+}
+
+void LatencyStats::reset() {
+    if (!active) return;
+    std::fill(commands.begin(), commands.end(), LatencyHistogram());
+    std::fill(addresses.begin(), addresses.end(), LatencyHistogram());
+    category_ns.fill(0);
+}
+
+void LatencyStats::recordCommand(size_t kind, int addr, uint64_t ns) {
+    if (kind < commands.size()) {
+        commands[kind].record(ns);
+    }
+    if (addr >= 0) {
+        addresses[addr & 0x7F].record(ns);
+    }
+}
+
+static void printRow(std::ostream& out, const LatencyHistogram& h) {
+    out << std::setw(10) << h.count()
+        << std::setw(12) << std::setprecision(3) << h.total() / 1e6
+        << std::setw(11) << std::setprecision(1) << h.percentile(0.50) / 1e3
+        << std::setw(11) << h.percentile(0.99) / 1e3
+        << std::setw(11) << h.max() / 1e3 << "\n";
+}
+
+void LatencyStats::print(std::ostream& out, const char* const* kind_names, uint64_t wall_ns) const {
+    if (!active) return;
+
+    out << std::fixed;
+    out << "Command latency:\n"
+        << "  command           count    total ms     p50 us     p99 us     max us\n";
+    for (size_t k = 0; k < commands.size(); k++) {
+        if (commands[k].count() == 0) continue;
+        out << "  " << std::left << std::setw(12) << kind_names[k] << std::right;
+        printRow(out, commands[k]);
+    }
+
+    out << "Device latency:\n"
+        << "  addr              count    total ms     p50 us     p99 us     max us\n";
+    for (size_t a = 0; a < addresses.size(); a++) {
+        if (addresses[a].count() == 0) continue;
+        out << "  0x" << std::hex << std::setw(2) << std::setfill('0') << a
+            << std::dec << std::setfill(' ') << "        ";
+        printRow(out, addresses[a]);
+    }
+
+    static const char* const names[] = {"bus", "sleep", "retry", "compile", "decode"};
+    uint64_t accounted = 0;
+    out << "Wall clock " << std::setprecision(3) << wall_ns / 1e6 << " ms:";
+    for (size_t c = 0; c < category_ns.size(); c++) {
+        accounted += category_ns[c];
+        out << " " << names[c] << " " << category_ns[c] / 1e6 << " ms";
+        if (wall_ns) out << " (" << std::setprecision(1) << 100.0 * category_ns[c] / wall_ns << "%)";
+        out << std::setprecision(3) << ",";
+    }
+    uint64_t other = wall_ns > accounted ? wall_ns - accounted : 0;
+    out << " other " << other / 1e6 << " ms\n";
+    out.unsetf(std::ios::floatfield);
+}
@@ -1,8 +1,17 @@
 #include "i2c_player.hpp"
 #include "error_action.hpp"
+#include "bus/i2c_bus.hpp"
+#include "bus/trace_bus.hpp"
+#include "daemon.hpp"
+#include "bus_scanner.hpp"
+#include "device_inventory.hpp"
+#include "script_compiler.hpp"
+#include <filesystem>
 #include <iostream>
+#include <sstream>
 #include <string>
 #include <stdexcept>
+#include <vector>
 
 // Parser includes
 #include "parsers/ds3231_parser.hpp"
@@ -14,26 +23,72 @@
 
 void printUsage(const char* progname) {
     std::cerr << "Usage: " << progname << " --input=<csv_file> --device=<i2c_device> [OPTIONS]\n"
+              << "       " << progname << " --replay=<trace_file> --device=<i2c_device> [OPTIONS]\n"
+              << "       " << progname << " --daemon[=<socket>] --device=<i2c_device> [OPTIONS]\n"
+              << "       " << progname << " --connect[=<socket>] --input=<csv_file>\n"
+              << "       " << progname << " --scan[=<dev>,...] [--device=<i2c_device>]\n"
               << "Options:\n"
-              << "  --input=<file>       Input CSV file with I2C transactions\n"
+              << "  --input=<file>       Input CSV file with I2C transactions, - to stream from stdin\n"
               << "  --device=<dev>       I2C device (e.g., /dev/i2c-0)\n"
               << "  --verbose            Enable verbose output\n"
               << "  --i2cwaitms=<ms>     Wait time between I2C operations in milliseconds (default: 1)\n"
+              << "  --timing=<file>      Per-device timing profiles: addr,bus_free_us,settle_us,conversion_us\n"
               << "  --onerror=<action>   Action on NAK/error: stop|retry|continue (default: stop)\n"
               << "  --retries=<n>        Number of retries on error (default: 3)\n"
+              << "  --backoff=<policy>   Retry backoff: fixed|exp|jitter (default: fixed)\n"
+              << "  --backoff-us=<us>    Base retry backoff in microseconds (default: 2 x i2cwaitms)\n"
+              << "  --kernel-retries     Let the adapter retry (I2C_RETRIES) instead of userspace\n"
+              << "  --bus-timeout=<ms>   Adapter transfer timeout (I2C_TIMEOUT)\n"
+              << "  --bus=<backend>      Bus backend: auto|i2c|smbus (default: auto)\n"
+              << "  --pec                Enable SMBus Packet Error Checking (smbus backend)\n"
+              << "  --xfer=<mode>        Register read mode: rdwr|split (default: rdwr)\n"
+              << "  --eeprom-sync        Program EEPROM FILE commands like SYNC (only changed pages)\n"
+              << "  --batch              Coalesce consecutive WRITE/READ commands into I2C_RDWR batches\n"
+              << "  --output=<format>    PRINT_RECORD output: report|text|csv|json|bin (default: report)\n"
+              << "  --cal-cache=<file>   Calibration cache file, none to disable (default: ~/.cache/i2c-player/calibration.csv)\n"
+              << "  --sample-out=<file>  Destination of SAMPLE frames, - for stdout (default: -)\n"
+              << "  --sample-format=<f>  SAMPLE frame format: csv|bin (default: csv)\n"
+              << "  --sample-ring=<n>    SAMPLE ring depth in frames (default: 4096)\n"
+              << "  --stats              Print per-command latency percentiles and a wall-clock breakdown\n"
+              << "  --trace=<file>       Record every bus transaction into a binary trace\n"
+              << "  --replay=<file>      Re-issue the transactions of a trace instead of running a script\n"
+              << "  --replay-timing=<t>  Replay pace: original|max (default: original)\n"
+              << "  --daemon[=<socket>]  Keep the bus open and serve requests on a Unix socket\n"
+              << "                       (default: $XDG_RUNTIME_DIR/i2c-player.sock)\n"
+              << "  --connect[=<socket>] Run --input on a daemon instead of opening the bus\n"
+              << "  --scan[=<dev>,...]   Probe 0x03-0x77 on the listed buses (default: --device, else all\n"
+              << "                       /dev/i2c-*), identify known parts and update the inventory\n"
+              << "  --inventory=<file>   Device inventory written by --scan and checked before a run,\n"
+              << "                       none to disable (default: ~/.cache/i2c-player/inventory.csv)\n"
               << "\nSupported CSV commands:\n"
               << "  WRITE,addr,reg,data          Write single byte\n"
               << "  WRITE1,addr,data             Write single byte without register\n"
               << "  WRITE16,addr,reg,data        Write 16-bit value\n"
               << "  READ,addr,reg                Read single byte\n"
-              << "  POLL,addr,reg,mask,exp,t,i   Poll register with timeout\n"
+              << "  READN,addr,reg,count         Burst read count bytes (register auto-increment)\n"
+              << "  READBLOCK,addr,reg           SMBus block read (device sends the byte count)\n"
+              << "  POLL,addr,reg,mask,exp,t,i[,h] Poll register with timeout, interval (min..max backs off), hold-off\n"
+              << "  POLL_ANY,t,i,h,a:r:m:e,...   Poll until any condition is met\n"
+              << "  POLL_ALL,t,i,h,a:r:m:e,...   Poll until all conditions are met\n"
+              << "  TIMING,addr,free,settle,conv Declare device timing profile (microseconds)\n"
               << "  DELAY,milliseconds           Insert delay\n"
+              << "  DELAY_US,microseconds        Insert delay with microsecond resolution\n"
               << "  FILE,addr,reg,filename       Write file contents\n"
+              << "  FILE,addr,off,filename,type  Program 24Cxx EEPROM (e.g. 24C64) with page writes\n"
+              << "  SYNC,addr,off,filename,type  Read back 24Cxx EEPROM, rewrite only changed pages, verify\n"
               << "  LOOP,count                   Start loop block\n"
+              << "  LOOP_EVERY,period_us,count   Start loop block with a fixed iteration period\n"
               << "  ENDLOOP                      End loop block\n"
+              << "  SAMPLE,rate_hz,count,device  Start block whose reads form one timestamped frame per period\n"
+              << "  ENDSAMPLE                    End sample block\n"
+              << "  CALIBRATE,addr,device        Read (or load cached) device calibration, e.g. BMP280\n"
               << "  START_RECORD,size            Start recording reads\n"
               << "  STOP_RECORD                  Stop recording reads\n"
               << "  PRINT_RECORD,device          Parse and print recorded data\n"
+              << "  INCLUDE,file                 Insert the commands and SUBs of another script\n"
+              << "  SUB,name,param...            Start subroutine; $param is replaced by the CALL argument\n"
+              << "  ENDSUB                       End subroutine\n"
+              << "  CALL,name,arg...             Insert a subroutine (compiled once per argument list)\n"
               << "\nExample: " << progname << " --input=init-serializer.csv --device=/dev/i2c-0 --onerror=retry\n";
 }
 
@@ -54,45 +109,235 @@ int main(int argc, char* argv[]) {
     int i2c_wait_ms = 1;
     ErrorAction error_action = ErrorAction::STOP;
     int retries = 3;
+    BusOptions bus_options;
+    bool batch = false;
+    bool eeprom_sync = false;
+    std::string timing_file;
+    BackoffPolicy backoff = BackoffPolicy::FIXED;
+    int backoff_us = -1;
+    bool kernel_retries = false;
+    int bus_timeout_ms = -1;
+    std::string sample_out = "-";
+    SampleFormat sample_format = SampleFormat::CSV;
+    size_t sample_ring = 4096;
+    OutputFormat output_format = OutputFormat::REPORT;
+    std::string cal_cache = CalibrationCache::defaultPath();
+    bool stats = false;
+    std::string trace_file;
+    std::string replay_file;
+    bool replay_original_timing = true;
+    std::string daemon_socket;
+    std::string connect_socket;
+    bool scan = false;
+    std::vector<std::string> scan_buses;
+    std::string inventory_file = DeviceInventory::defaultPath();
 
-    // Parse command line arguments
-    for (int i = 1; i < argc; i++) {
-        std::string arg = argv[i];
-        if (arg.substr(0, 8) == "--input=") {
-            input_file = arg.substr(8);
-        } else if (arg.substr(0, 9) == "--device=") {
-            i2c_device = arg.substr(9);
-        } else if (arg == "--verbose") {
-            verbose = true;
-        } else if (arg.substr(0, 11) == "--i2cwaitms=") {
-            i2c_wait_ms = std::stoi(arg.substr(11));
-        } else if (arg.substr(0, 10) == "--onerror=") {
-            std::string action = arg.substr(10);
-            if (action == "stop") error_action = ErrorAction::STOP;
-            else if (action == "retry") error_action = ErrorAction::RETRY;
-            else if (action == "continue") error_action = ErrorAction::CONTINUE;
-            else throw std::runtime_error("Invalid error action: " + action);
-        } else if (arg.substr(0, 10) == "--retries=") {
-            retries = std::stoi(arg.substr(10));
-        } else {
+    // Parse command line arguments; numbers are checked as strictly as
+    // script operands
+    try {
+        for (int i = 1; i < argc; i++) {
+            std::string arg = argv[i];
+            if (arg.substr(0, 8) == "--input=") {
+                input_file = arg.substr(8);
+            } else if (arg.substr(0, 9) == "--device=") {
+                i2c_device = arg.substr(9);
+            } else if (arg == "--verbose") {
+                verbose = true;
+            } else if (arg.substr(0, 12) == "--i2cwaitms=") {
+                i2c_wait_ms = ScriptCompiler::parseInt(arg.substr(12), 0, 1000000, "--i2cwaitms");
+            } else if (arg.substr(0, 9) == "--timing=") {
+                timing_file = arg.substr(9);
+            } else if (arg.substr(0, 10) == "--onerror=") {
+                std::string action = arg.substr(10);
+                if (action == "stop") error_action = ErrorAction::STOP;
+                else if (action == "retry") error_action = ErrorAction::RETRY;
+                else if (action == "continue") error_action = ErrorAction::CONTINUE;
+                else throw std::runtime_error("Invalid error action: " + action);
+            } else if (arg.substr(0, 10) == "--retries=") {
+                retries = ScriptCompiler::parseInt(arg.substr(10), 0, 1000, "--retries");
+            } else if (arg.substr(0, 6) == "--bus=") {
+                std::string type = arg.substr(6);
+                if (type == "auto") bus_options.type = BusType::AUTO;
+                else if (type == "i2c") bus_options.type = BusType::I2C;
+                else if (type == "smbus") bus_options.type = BusType::SMBUS;
+                else throw std::runtime_error("Invalid bus backend: " + type);
+            } else if (arg == "--pec") {
+                bus_options.pec = true;
+            } else if (arg.substr(0, 10) == "--backoff=") {
+                std::string policy = arg.substr(10);
+                if (policy == "fixed") backoff = BackoffPolicy::FIXED;
+                else if (policy == "exp") backoff = BackoffPolicy::EXPONENTIAL;
+                else if (policy == "jitter") backoff = BackoffPolicy::JITTERED;
+                else throw std::runtime_error("Invalid backoff policy: " + policy);
+            } else if (arg.substr(0, 13) == "--backoff-us=") {
+                backoff_us = ScriptCompiler::parseInt(arg.substr(13), 0, INT32_MAX, "--backoff-us");
+            } else if (arg == "--kernel-retries") {
+                kernel_retries = true;
+            } else if (arg.substr(0, 14) == "--bus-timeout=") {
+                bus_timeout_ms = ScriptCompiler::parseInt(arg.substr(14), 0, INT32_MAX, "--bus-timeout");
+            } else if (arg == "--eeprom-sync") {
+                eeprom_sync = true;
+            } else if (arg == "--batch") {
+                batch = true;
+            } else if (arg == "--stats") {
+                stats = true;
+            } else if (arg.substr(0, 8) == "--trace=") {
+                trace_file = arg.substr(8);
+            } else if (arg.substr(0, 9) == "--replay=") {
+                replay_file = arg.substr(9);
+            } else if (arg.substr(0, 16) == "--replay-timing=") {
+                std::string timing = arg.substr(16);
+                if (timing == "original") replay_original_timing = true;
+                else if (timing == "max") replay_original_timing = false;
+                else throw std::runtime_error("Invalid replay timing: " + timing);
+            } else if (arg == "--daemon") {
+                daemon_socket = I2CDaemon::defaultSocketPath();
+            } else if (arg.substr(0, 9) == "--daemon=") {
+                daemon_socket = arg.substr(9);
+            } else if (arg == "--connect") {
+                connect_socket = I2CDaemon::defaultSocketPath();
+            } else if (arg.substr(0, 10) == "--connect=") {
+                connect_socket = arg.substr(10);
+            } else if (arg == "--scan") {
+                scan = true;
+            } else if (arg.substr(0, 7) == "--scan=") {
+                scan = true;
+                std::stringstream list(arg.substr(7));
+                std::string bus;
+                while (std::getline(list, bus, ',')) {
+                    if (!bus.empty()) scan_buses.push_back(bus);
+                }
+            } else if (arg.substr(0, 12) == "--inventory=") {
+                inventory_file = arg.substr(12);
+                if (inventory_file == "none") inventory_file.clear();
+            } else if (arg.substr(0, 12) == "--cal-cache=") {
+                cal_cache = arg.substr(12);
+                if (cal_cache == "none") cal_cache.clear();
+            } else if (arg.substr(0, 9) == "--output=") {
+                std::string format = arg.substr(9);
+                if (format == "report") output_format = OutputFormat::REPORT;
+                else if (format == "text") output_format = OutputFormat::TEXT;
+                else if (format == "csv") output_format = OutputFormat::CSV;
+                else if (format == "json") output_format = OutputFormat::JSON;
+                else if (format == "bin") output_format = OutputFormat::BINARY;
+                else throw std::runtime_error("Invalid output format: " + format);
+            } else if (arg.substr(0, 13) == "--sample-out=") {
+                sample_out = arg.substr(13);
+            } else if (arg.substr(0, 16) == "--sample-format=") {
+                std::string format = arg.substr(16);
+                if (format == "csv") sample_format = SampleFormat::CSV;
+                else if (format == "bin") sample_format = SampleFormat::BINARY;
+                else throw std::runtime_error("Invalid sample format: " + format);
+            } else if (arg.substr(0, 14) == "--sample-ring=") {
+                sample_ring = ScriptCompiler::parseInt(arg.substr(14), 1, INT32_MAX, "--sample-ring");
+            } else if (arg.substr(0, 7) == "--xfer=") {
+                std::string mode = arg.substr(7);
+                if (mode == "rdwr") bus_options.transfer_mode = TransferMode::RDWR;
+                else if (mode == "split") bus_options.transfer_mode = TransferMode::SPLIT;
+                else throw std::runtime_error("Invalid transfer mode: " + mode);
+            } else {
+                printUsage(argv[0]);
+                return 1;
+            }
+        }
+    } catch (const std::exception& e) {
+        std::cerr << "Error: " << e.what() << "\n";
+        printUsage(argv[0]);
+        return 1;
+    }
+
+    if (scan) {
+        try {
+            if (scan_buses.empty() && !i2c_device.empty()) {
+                scan_buses.push_back(i2c_device);
+            }
+            if (scan_buses.empty()) {
+                scan_buses = listBuses();
+            }
+            if (scan_buses.empty()) {
+                throw std::runtime_error("No /dev/i2c-* adapters found");
+            }
+
+            DeviceInventory inventory;
+            inventory.setFile(inventory_file);
+            bool failed = false;
+            for (const BusScan& result : scanBuses(scan_buses, bus_options)) {
+                printScan(std::cout, result);
+                if (result.error.empty()) {
+                    inventory.update(result.device, result.devices);
+                } else {
+                    failed = true;
+                }
+            }
+            if (!inventory_file.empty()) {
+                std::cout << "Inventory: " << inventory_file << "\n";
+            }
+            return failed ? 1 : 0;
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
+    }
+
+    // The daemon owns the bus, so a client only needs the script
+    if (!connect_socket.empty()) {
+        if (input_file.empty() || input_file == "-") {
             printUsage(argv[0]);
             return 1;
         }
+        try {
+            // The daemon resolves paths against its own working directory
+            return runDaemonClient(connect_socket,
+                                   "RUN " + std::filesystem::absolute(input_file).string());
+        } catch (const std::exception& e) {
+            std::cerr << "Error: " << e.what() << "\n";
+            return 1;
+        }
     }
 
     // Validate required arguments
-    if (input_file.empty() || i2c_device.empty()) {
+    if ((input_file.empty() && replay_file.empty() && daemon_socket.empty()) ||
+        i2c_device.empty()) {
         printUsage(argv[0]);
         return 1;
     }
 
     try {
         // Create I2C player instance
-        I2CPlayer player(i2c_device, verbose, i2c_wait_ms, error_action, retries);
+        std::unique_ptr<I2CBus> bus = createBus(i2c_device, bus_options, verbose);
+        if (!trace_file.empty()) {
+            bus = std::make_unique<TraceBus>(std::move(bus), trace_file);
+        }
+        I2CPlayer player(std::move(bus), verbose, i2c_wait_ms, error_action, retries);
+        player.setBatchMode(batch);
+        player.setEEPROMSync(eeprom_sync);
+        player.setStats(stats);
+        player.setSampleOutput(sample_out, sample_format, sample_ring);
+        player.setOutputFormat(output_format);
+        player.setCalibrationCache(cal_cache);
+        player.setInventory(inventory_file);
+        player.setBackoff(backoff, backoff_us >= 0 ? backoff_us : i2c_wait_ms * 2000);
+        if (kernel_retries || bus_timeout_ms >= 0) {
+            player.setKernelRetries(kernel_retries, bus_timeout_ms);
+        }
+        if (!timing_file.empty()) {
+            player.loadTimingFile(timing_file);
+        }
         
         // Register all available device parsers
         registerParsers(player);
 
+        if (!daemon_socket.empty()) {
+            I2CDaemon daemon(player, daemon_socket, verbose, error_action);
+            daemon.serve();
+            return 0;
+        }
+
+        if (!replay_file.empty()) {
+            player.replayTrace(replay_file, replay_original_timing);
+            return 0;
+        }
+
         // Execute the I2C commands from the CSV file
         player.playFile(input_file);
         
@@ -0,0 +1,39 @@
+#include "mapped_file.hpp"
+#include <stdexcept>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+MappedFile::MappedFile(const std::string& path, const char* what)
+    : map(nullptr), length(0) {
+    int fd = open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        throw std::runtime_error(std::string("Failed to open ") + what + ": " + path);
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) < 0) {
+        close(fd);
+        throw std::runtime_error(std::string("Failed to open ") + what + ": " + path);
+    }
+    length = st.st_size;
+
+    // mmap rejects empty mappings; an empty file is simply no data
+    if (length > 0) {
+        void* mapped = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (mapped == MAP_FAILED) {
+            close(fd);
+            throw std::runtime_error(std::string("Failed to map ") + what + ": " + path);
+        }
+        map = static_cast<const uint8_t*>(mapped);
+        madvise(mapped, length, MADV_SEQUENTIAL);
+    }
+    close(fd);
+}
+
+MappedFile::~MappedFile() {
+    if (map) {
+        munmap(const_cast<uint8_t*>(map), length);
+    }
+}
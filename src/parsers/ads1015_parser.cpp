@@ -39,6 +39,20 @@ void ADS1015Parser::parse(const std::vector<uint8_t>& buffer) {
     }
 }
 
+bool ADS1015Parser::decode(const std::vector<uint8_t>& buffer, DecodeResult& result) const {
+    if (buffer.size() < 2) return false;
+
+    int16_t raw_value = (buffer[0] << 4) | (buffer[1] >> 4);
+    if (raw_value & 0x800) {
+        raw_value |= 0xF000;
+    }
+
+    result.clear("ADS1015");
+    result.add("raw_value", "", raw_value);
+    result.add("voltage", "V", convertToVoltage(raw_value), 3);
+    return true;
+}
+
 float ADS1015Parser::convertToVoltage(int16_t raw_value) const {
     // Convert raw ADC value to voltage
     // For 12-bit ADC in differential mode, range is -2048 to +2047
@@ -81,3 +95,24 @@ void ADS1015Parser::printDiagnostics(int16_t raw_value) const {
               << "  GAIN_0_512V (4): ±0.512V range\n"
               << "  GAIN_0_256V (5): ±0.256V range\n";
 }
+
+BatchLayout ADS1015Parser::batchLayout() const {
+    static const BatchColumn columns[] = {
+        {"raw_value", ""},
+        {"voltage", "V"}
+    };
+    return {2, 2, columns};
+}
+
+void ADS1015Parser::decodeBatch(const uint8_t* frames, size_t count, size_t stride,
+                                float* const* columns) const {
+    float* __restrict raw_value = columns[0];
+    float* __restrict voltage = columns[1];
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* f = frames + i * stride;
+        // Sign-extend the 12-bit result without a branch
+        int16_t raw = static_cast<int16_t>(((f[0] << 4) | (f[1] >> 4)) << 4) >> 4;
+        raw_value[i] = raw;
+        voltage[i] = (static_cast<float>(raw) * VOLTAGE_RANGE) / TOTAL_STEPS;
+    }
+}
@@ -32,6 +32,16 @@ void BH1750Parser::parse(const std::vector<uint8_t>& buffer) {
     printDiagnostics(light_intensity);
 }
 
+bool BH1750Parser::decode(const std::vector<uint8_t>& buffer, DecodeResult& result) const {
+    if (buffer.size() < 2) return false;
+
+    uint16_t raw_value = (buffer[0] << 8) | buffer[1];
+    result.clear("BH1750");
+    result.add("raw_value", "", raw_value);
+    result.add("illuminance", "lux", calculateLux(raw_value), 2);
+    return true;
+}
+
 float BH1750Parser::calculateLux(uint16_t raw_value) const {
     // Convert raw value to lux using standard conversion factor
     // The formula is: raw_value / 1.2 (typical)
@@ -72,3 +82,23 @@ void BH1750Parser::printModeReference() const {
               << "- Bright light: Low Resolution (0x13)\n"
               << "- Power saving: One-Time modes (0x20/0x21/0x23)\n";
 }
+
+BatchLayout BH1750Parser::batchLayout() const {
+    static const BatchColumn columns[] = {
+        {"raw_value", ""},
+        {"illuminance", "lux"}
+    };
+    return {2, 2, columns};
+}
+
+void BH1750Parser::decodeBatch(const uint8_t* frames, size_t count, size_t stride,
+                               float* const* columns) const {
+    float* __restrict raw_value = columns[0];
+    float* __restrict illuminance = columns[1];
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* f = frames + i * stride;
+        uint16_t raw = (f[0] << 8) | f[1];
+        raw_value[i] = raw;
+        illuminance[i] = static_cast<float>(raw) / LUX_CONVERSION_FACTOR;
+    }
+}
@@ -1,6 +1,7 @@
 #include "parsers/bmp280_parser.hpp"
 #include <iostream>
 #include <iomanip>
+#include <algorithm>
 
 void BMP280Parser::parse(const std::vector<uint8_t>& buffer) {
     if (buffer.size() < 6) {
@@ -10,11 +11,12 @@ void BMP280Parser::parse(const std::vector<uint8_t>& buffer) {
 
     // Temperature calculation (based on BMP280 datasheet)
     int32_t adc_T = (buffer[0] << 12) | (buffer[1] << 4) | (buffer[2] >> 4);
-    float temperature = calculateTemperature(adc_T);
+    int32_t t_fine = compensateTFine(cal, adc_T);
+    float temperature = temperatureFromTFine(t_fine);
 
     // Pressure calculation (based on BMP280 datasheet)
     int32_t adc_P = (buffer[3] << 12) | (buffer[4] << 4) | (buffer[5] >> 4);
-    float pressure = calculatePressure(adc_P);
+    float pressure = pressureFromTFine(cal, adc_P, t_fine);
 
     std::cout << "BMP280 Sensor Data:\n";
     std::cout << "Temperature: "
@@ -26,15 +28,38 @@ void BMP280Parser::parse(const std::vector<uint8_t>& buffer) {
               << pressure / 100.0f << " hPa\n";  // Convert Pa to hPa
 }
 
-float BMP280Parser::calculateTemperature(int32_t adc_T) const {
+bool BMP280Parser::decode(const std::vector<uint8_t>& buffer, DecodeResult& result) const {
+    if (buffer.size() < 6) return false;
+
+    int32_t adc_T = (buffer[0] << 12) | (buffer[1] << 4) | (buffer[2] >> 4);
+    int32_t adc_P = (buffer[3] << 12) | (buffer[4] << 4) | (buffer[5] >> 4);
+
+    // The pressure compensation depends on the temperature's t_fine, which
+    // stays local so decode() can run concurrently on a shared parser
+    int32_t t_fine = compensateTFine(cal, adc_T);
+    result.clear("BMP280");
+    result.add("temperature", "degC", temperatureFromTFine(t_fine), 2);
+    result.add("pressure", "hPa", pressureFromTFine(cal, adc_P, t_fine) / 100.0f, 2);
+    return true;
+}
+
+int32_t BMP280Parser::compensateTFine(const Calibration& cal, int32_t adc_T) {
+    const int32_t dig_T1 = cal.dig_T1;
+    const int32_t dig_T2 = cal.dig_T2;
+    const int32_t dig_T3 = cal.dig_T3;
     int32_t var1 = ((((adc_T >> 3) - (dig_T1 << 1))) * dig_T2) >> 11;
     int32_t var2 = (((((adc_T >> 4) - dig_T1) * ((adc_T >> 4) - dig_T1)) >> 12) * dig_T3) >> 14;
-    t_fine = var1 + var2;
-    float temperature = ((t_fine * 5 + 128) >> 8) / 100.0f;
-    return temperature;
+    return var1 + var2;
 }
 
-float BMP280Parser::calculatePressure(int32_t adc_P) const {
+float BMP280Parser::temperatureFromTFine(int32_t t_fine) {
+    return ((t_fine * 5 + 128) >> 8) / 100.0f;
+}
+
+float BMP280Parser::pressureFromTFine(const Calibration& cal, int32_t adc_P, int32_t t_fine) {
+    const int64_t dig_P1 = cal.dig_P1, dig_P2 = cal.dig_P2, dig_P3 = cal.dig_P3;
+    const int64_t dig_P4 = cal.dig_P4, dig_P5 = cal.dig_P5, dig_P6 = cal.dig_P6;
+    const int64_t dig_P7 = cal.dig_P7, dig_P8 = cal.dig_P8, dig_P9 = cal.dig_P9;
     int64_t var1, var2, p;
 
     var1 = static_cast<int64_t>(t_fine) - 128000;
@@ -57,3 +82,75 @@ float BMP280Parser::calculatePressure(int32_t adc_P) const {
 
     return static_cast<float>(p) / 256.0f;
 }
+
+CalibrationBlock BMP280Parser::calibrationBlock() const {
+    return {CALIBRATION_REG, CALIBRATION_LEN};
+}
+
+bool BMP280Parser::setCalibration(const std::vector<uint8_t>& data) {
+    if (data.size() < CALIBRATION_LEN) return false;
+
+    // Little-endian words: T1 and P1 unsigned, the rest signed
+    auto u16 = [&](size_t i) { return static_cast<int32_t>(data[i] | (data[i + 1] << 8)); };
+    auto s16 = [&](size_t i) { return static_cast<int32_t>(static_cast<int16_t>(u16(i))); };
+
+    Calibration trim;
+    trim.dig_T1 = u16(0);
+    trim.dig_T2 = s16(2);
+    trim.dig_T3 = s16(4);
+    trim.dig_P1 = u16(6);
+    trim.dig_P2 = s16(8);
+    trim.dig_P3 = s16(10);
+    trim.dig_P4 = s16(12);
+    trim.dig_P5 = s16(14);
+    trim.dig_P6 = s16(16);
+    trim.dig_P7 = s16(18);
+    trim.dig_P8 = s16(20);
+    trim.dig_P9 = s16(22);
+
+    // Erased or unconnected parts read back all zeros or all ones
+    if (trim.dig_T1 == 0 || trim.dig_P1 == 0 || trim.dig_T1 == 0xFFFF || trim.dig_P1 == 0xFFFF) {
+        return false;
+    }
+    cal = trim;
+    return true;
+}
+
+BatchLayout BMP280Parser::batchLayout() const {
+    static const BatchColumn columns[] = {
+        {"temperature", "degC"},
+        {"pressure", "hPa"}
+    };
+    return {6, 2, columns};
+}
+
+void BMP280Parser::decodeBatch(const uint8_t* frames, size_t count, size_t stride,
+                               float* const* columns) const {
+    float* __restrict temperature = columns[0];
+    float* __restrict pressure = columns[1];
+    const Calibration trim = cal;   // Local copy, cannot alias the outputs
+    int32_t adc_T[BATCH_CHUNK];
+    int32_t adc_P[BATCH_CHUNK];
+    int32_t t_fine_batch[BATCH_CHUNK];
+
+    for (size_t base = 0; base < count; base += BATCH_CHUNK) {
+        size_t n = std::min(BATCH_CHUNK, count - base);
+        const uint8_t* frame = frames + base * stride;
+
+        // Separate passes keep each loop free of cross-iteration state: the
+        // unpack and 32-bit temperature passes vectorize, the pressure pass
+        // is limited by its 64-bit division
+        for (size_t i = 0; i < n; i++) {
+            const uint8_t* f = frame + i * stride;
+            adc_T[i] = (f[0] << 12) | (f[1] << 4) | (f[2] >> 4);
+            adc_P[i] = (f[3] << 12) | (f[4] << 4) | (f[5] >> 4);
+        }
+        for (size_t i = 0; i < n; i++) {
+            t_fine_batch[i] = compensateTFine(trim, adc_T[i]);
+            temperature[base + i] = temperatureFromTFine(t_fine_batch[i]);
+        }
+        for (size_t i = 0; i < n; i++) {
+            pressure[base + i] = pressureFromTFine(trim, adc_P[i], t_fine_batch[i]) / 100.0f;
+        }
+    }
+}
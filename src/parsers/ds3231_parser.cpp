@@ -42,6 +42,28 @@ void DS3231Parser::parse(const std::vector<uint8_t>& buffer) {
     printDiagnostics(buffer);
 }
 
+bool DS3231Parser::decode(const std::vector<uint8_t>& buffer, DecodeResult& result) const {
+    if (buffer.size() < 7) return false;
+
+    auto hour_format = extractHours(buffer[2]);
+    uint8_t hours = hour_format.hour;
+    if (hour_format.is_12_hour) {
+        // Report a 24-hour clock so consumers don't need the AM/PM flag
+        hours = (hours % 12) + (hour_format.is_pm ? 12 : 0);
+    }
+
+    result.clear("DS3231");
+    result.add("year", "", 2000 + extractYear(buffer[6]));
+    result.add("month", "", extractMonth(buffer[5]));
+    result.add("day", "", extractDay(buffer[4]));
+    result.add("hours", "h", hours);
+    result.add("minutes", "min", extractMinutes(buffer[1]));
+    result.add("seconds", "s", extractSeconds(buffer[0]));
+    result.add("day_of_week", "", buffer[3]);
+    result.add("oscillator_stop", "", (buffer[0] & 0x80) ? 1 : 0);
+    return true;
+}
+
 uint8_t DS3231Parser::bcdToDecimal(uint8_t bcd) const {
     return ((bcd >> 4) * 10) + (bcd & 0x0F);
 }
@@ -37,6 +37,26 @@ void VEML7700Parser::parse(const std::vector<uint8_t>& buffer) {
     printDiagnostics(raw_value);
 }
 
+bool VEML7700Parser::decode(const std::vector<uint8_t>& buffer, DecodeResult& result) const {
+    if (buffer.size() < 2) return false;
+
+    uint16_t raw_value = buffer[0] | (buffer[1] << 8);
+    result.clear("VEML7700");
+    result.add("raw_value", "", raw_value);
+
+    // Same heuristic as parse(): gain or integration bits mark a configuration read
+    if (raw_value & (ALS_GAIN_MASK | ALS_IT_MASK)) {
+        result.add("gain", "", getGainFactor(raw_value), 3);
+        result.add("integration", "ms", 100.0f * getIntegrationFactor(raw_value));
+        result.add("shutdown", "", raw_value & ALS_SD_MASK);
+        result.add("interrupt", "", (raw_value & ALS_INT_EN_MASK) ? 1 : 0);
+        return true;
+    }
+
+    result.add("illuminance", "lux", calculateLux(raw_value), 2);
+    return true;
+}
+
 float VEML7700Parser::calculateLux(uint16_t raw_value) const {
     // Basic conversion using default resolution
     float lux = raw_value * BASE_RESOLUTION;
@@ -161,3 +181,23 @@ void VEML7700Parser::printDiagnostics(uint16_t raw_value) const {
                   << "  - Using extended dynamic range mode\n";
     }
 }
+
+BatchLayout VEML7700Parser::batchLayout() const {
+    static const BatchColumn columns[] = {
+        {"raw_value", ""},
+        {"illuminance", "lux"}
+    };
+    return {2, 2, columns};
+}
+
+void VEML7700Parser::decodeBatch(const uint8_t* frames, size_t count, size_t stride,
+                                 float* const* columns) const {
+    float* __restrict raw_value = columns[0];
+    float* __restrict illuminance = columns[1];
+    for (size_t i = 0; i < count; i++) {
+        const uint8_t* f = frames + i * stride;
+        uint16_t raw = f[0] | (f[1] << 8);
+        raw_value[i] = raw;
+        illuminance[i] = raw * BASE_RESOLUTION;
+    }
+}
@@ -0,0 +1,137 @@
+#include "record_emitter.hpp"
+#include <charconv>
+#include <cmath>
+#include <cstring>
+
+RecordEmitter::RecordEmitter(std::ostream& out_stream, OutputFormat format_)
+    : out(out_stream), format(format_), csv_device(nullptr), csv_fields(0) {
+    buffer.reserve(512);
+}
+
+void RecordEmitter::setFormat(OutputFormat format_) {
+    format = format_;
+    csv_device = nullptr;
+}
+
+void RecordEmitter::emit(const DecodeResult& result, uint64_t timestamp_ns) {
+    buffer.clear();
+    switch (format) {
+        case OutputFormat::REPORT:
+        case OutputFormat::TEXT:   emitText(result); break;
+        case OutputFormat::CSV:    emitCSV(result, timestamp_ns); break;
+        case OutputFormat::JSON:   emitJSON(result, timestamp_ns); break;
+        case OutputFormat::BINARY: emitBinary(result, timestamp_ns); break;
+    }
+    out.write(buffer.data(), buffer.size());
+}
+
+void RecordEmitter::emitText(const DecodeResult& result) {
+    append(result.device);
+    append(':');
+    for (size_t i = 0; i < result.count; i++) {
+        const DecodedField& field = result.fields[i];
+        append(' ');
+        append(field.name);
+        append('=');
+        appendNumber(field.value, field.precision);
+        if (*field.unit) {
+            append(' ');
+            append(field.unit);
+        }
+    }
+    append('\n');
+}
+
+void RecordEmitter::emitCSV(const DecodeResult& result, uint64_t timestamp_ns) {
+    // Field layout is fixed per device, so a header is only needed when the
+    // device (or the layout, e.g. VEML7700 config vs. data) changes
+    if (csv_device != result.device || csv_fields != result.count) {
+        append("timestamp_ns,device");
+        for (size_t i = 0; i < result.count; i++) {
+            append(',');
+            appendKey(result.fields[i]);
+        }
+        append('\n');
+        csv_device = result.device;
+        csv_fields = result.count;
+    }
+
+    appendNumber(timestamp_ns);
+    append(',');
+    append(result.device);
+    for (size_t i = 0; i < result.count; i++) {
+        append(',');
+        appendNumber(result.fields[i].value, result.fields[i].precision);
+    }
+    append('\n');
+}
+
+void RecordEmitter::emitJSON(const DecodeResult& result, uint64_t timestamp_ns) {
+    append("{\"timestamp_ns\":");
+    appendNumber(timestamp_ns);
+    append(",\"device\":\"");
+    append(result.device);
+    append('"');
+    for (size_t i = 0; i < result.count; i++) {
+        append(",\"");
+        appendKey(result.fields[i]);
+        append("\":");
+        appendNumber(result.fields[i].value, result.fields[i].precision);
+    }
+    append("}\n");
+}
+
+void RecordEmitter::emitBinary(const DecodeResult& result, uint64_t timestamp_ns) {
+    // Record: u64 timestamp_ns, u8 device name length, name,
+    // u8 field count, f64 value per field (host byte order)
+    uint8_t name_len = std::strlen(result.device);
+    uint8_t count = result.count;
+    appendBytes(&timestamp_ns, sizeof(timestamp_ns));
+    appendBytes(&name_len, 1);
+    appendBytes(result.device, name_len);
+    appendBytes(&count, 1);
+    for (size_t i = 0; i < result.count; i++) {
+        appendBytes(&result.fields[i].value, sizeof(double));
+    }
+}
+
+void RecordEmitter::append(const char* str) {
+    buffer.insert(buffer.end(), str, str + std::strlen(str));
+}
+
+void RecordEmitter::append(char c) {
+    buffer.push_back(c);
+}
+
+void RecordEmitter::appendKey(const DecodedField& field) {
+    append(field.name);
+    if (*field.unit) {
+        append('_');
+        append(field.unit);
+    }
+}
+
+void RecordEmitter::appendNumber(uint64_t value) {
+    char digits[24];
+    auto res = std::to_chars(digits, digits + sizeof(digits), value);
+    buffer.insert(buffer.end(), digits, res.ptr);
+}
+
+void RecordEmitter::appendNumber(double value, uint8_t precision) {
+    if (!std::isfinite(value)) {
+        append(format == OutputFormat::JSON ? "null" : "nan");
+        return;
+    }
+    char digits[64];
+    auto res = std::to_chars(digits, digits + sizeof(digits), value,
+                             std::chars_format::fixed, precision);
+    if (res.ec != std::errc()) {
+        res = std::to_chars(digits, digits + sizeof(digits), value);
+    }
+    buffer.insert(buffer.end(), digits, res.ptr);
+}
+
+void RecordEmitter::appendBytes(const void* data, size_t len) {
+    const char* bytes = static_cast<const char*>(data);
+    buffer.insert(buffer.end(), bytes, bytes + len);
+}
@@ -0,0 +1,51 @@
+#include "retry_engine.hpp"
+#include <algorithm>
+#include <iomanip>
+
+RetryEngine::RetryEngine(int retries, ErrorAction action, uint32_t backoff_us)
+    : retry_count(retries), error_action(action), policy(BackoffPolicy::FIXED),
+      base_backoff_us(backoff_us), last_retries(0),
+      rng(static_cast<uint32_t>(monotonicNowNs())) {
+}
+
+void RetryEngine::setBackoff(BackoffPolicy backoff, uint32_t base_us) {
+    policy = backoff;
+    base_backoff_us = base_us;
+}
+
+uint64_t RetryEngine::backoffUs(int attempt) {
+    if (policy == BackoffPolicy::FIXED) {
+        return base_backoff_us;
+    }
+
+    uint64_t delay = std::min<uint64_t>(static_cast<uint64_t>(base_backoff_us) << std::min(attempt, 20),
+                                        MAX_BACKOFF_US);
+    if (policy == BackoffPolicy::JITTERED) {
+        delay = std::uniform_int_distribution<uint64_t>(0, delay)(rng);
+    }
+    return delay;
+}
+
+bool RetryEngine::hasErrors() const {
+    for (const auto& entry : stats) {
+        if (entry.naks || entry.timeouts || entry.other_errors) return true;
+    }
+    return false;
+}
+
+void RetryEngine::printStats(std::ostream& out) const {
+    out << "Per-address error statistics:\n"
+        << "  addr  transfers       naks   timeouts     errors    retries   failures\n";
+    for (size_t addr = 0; addr < stats.size(); addr++) {
+        const AddressErrorStats& entry = stats[addr];
+        if (entry.transfers == 0) continue;
+        out << "  0x" << std::hex << std::setw(2) << std::setfill('0') << addr
+            << std::dec << std::setfill(' ')
+            << std::setw(11) << entry.transfers
+            << std::setw(11) << entry.naks
+            << std::setw(11) << entry.timeouts
+            << std::setw(11) << entry.other_errors
+            << std::setw(11) << entry.retries
+            << std::setw(11) << entry.failures << "\n";
+    }
+}
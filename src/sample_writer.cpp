@@ -0,0 +1,165 @@
+#include "sample_writer.hpp"
+#include "timing.hpp"
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+
+SampleRing::SampleRing(size_t capacity, size_t frame_size_)
+    : frame_size(std::max<size_t>(frame_size_, 1)), head(0), tail(0) {
+    size_t size = 1;
+    while (size < capacity) size <<= 1;
+    mask = size - 1;
+
+    slots.resize(size);
+    arena.resize(size * frame_size);
+    for (size_t i = 0; i < size; i++) {
+        slots[i].data = arena.data() + i * frame_size;
+    }
+}
+
+bool SampleRing::push(uint64_t timestamp_ns, uint32_t sequence, uint16_t device,
+                      const uint8_t* data, uint16_t length) {
+    size_t h = head.load(std::memory_order_relaxed);
+    if (h - tail.load(std::memory_order_acquire) > mask) {
+        return false;
+    }
+
+    Slot& slot = slots[h & mask];
+    slot.timestamp_ns = timestamp_ns;
+    slot.sequence = sequence;
+    slot.device = device;
+    slot.length = std::min<size_t>(length, frame_size);
+    std::memcpy(slot.data, data, slot.length);
+
+    head.store(h + 1, std::memory_order_release);
+    return true;
+}
+
+const SampleRing::Slot* SampleRing::peek() {
+    size_t t = tail.load(std::memory_order_relaxed);
+    if (t == head.load(std::memory_order_acquire)) {
+        return nullptr;
+    }
+    return &slots[t & mask];
+}
+
+void SampleRing::release() {
+    tail.store(tail.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+}
+
+SampleWriter::SampleWriter(const std::string& path, SampleFormat format_, size_t ring_frames,
+                           size_t frame_size, const std::vector<std::string>& devices)
+    : ring(ring_frames, frame_size), format(format_), device_names(devices),
+      out(nullptr), owns_file(false), sequence(0), overrun_count(0),
+      written_count(0), done(false) {
+
+    if (path.empty() || path == "-") {
+        out = stdout;
+    } else {
+        out = std::fopen(path.c_str(), format == SampleFormat::BINARY ? "wb" : "w");
+        if (!out) {
+            throw std::runtime_error("Failed to open sample output: " + path);
+        }
+        owns_file = true;
+    }
+
+    // Worst case CSV line: timestamp, sequence, device and ",xx" per byte
+    line.resize(64 + ring.frameSize() * 3 +
+                std::max_element(device_names.begin(), device_names.end(),
+                                 [](const std::string& a, const std::string& b) {
+                                     return a.size() < b.size();
+                                 })->size());
+
+    writeHeader();
+    writer = std::thread(&SampleWriter::writerLoop, this);
+}
+
+SampleWriter::~SampleWriter() {
+    finish();
+}
+
+void SampleWriter::submit(uint64_t timestamp_ns, uint16_t device, const uint8_t* data,
+                          uint16_t length) {
+    if (!ring.push(timestamp_ns, sequence, device, data, length)) {
+        overrun_count++;
+    }
+    sequence++;
+}
+
+void SampleWriter::finish() {
+    if (!writer.joinable()) return;
+
+    done.store(true, std::memory_order_release);
+    writer.join();
+    std::fflush(out);
+    if (owns_file) {
+        std::fclose(out);
+        owns_file = false;
+    }
+}
+
+void SampleWriter::writerLoop() {
+    while (true) {
+        const SampleRing::Slot* slot = ring.peek();
+        if (slot) {
+            writeRecord(*slot);
+            ring.release();
+            written_count.fetch_add(1, std::memory_order_relaxed);
+            continue;
+        }
+
+        // Check for shutdown only when the ring is empty, so every frame
+        // pushed before finish() is written
+        if (done.load(std::memory_order_acquire)) {
+            if (!ring.peek()) break;
+            continue;
+        }
+        std::fflush(out);
+        sleepForUs(WRITER_IDLE_US);
+    }
+}
+
+void SampleWriter::writeHeader() {
+    if (format == SampleFormat::CSV) {
+        std::fputs("timestamp_ns,sequence,device,data\n", out);
+        return;
+    }
+
+    // Binary header: magic, version, device name table
+    std::fwrite("I2CS", 1, 4, out);
+    uint16_t version = 1;
+    uint16_t count = device_names.size();
+    std::fwrite(&version, sizeof(version), 1, out);
+    std::fwrite(&count, sizeof(count), 1, out);
+    for (const auto& name : device_names) {
+        uint8_t len = std::min<size_t>(name.size(), 255);
+        std::fwrite(&len, 1, 1, out);
+        std::fwrite(name.data(), 1, len, out);
+    }
+}
+
+void SampleWriter::writeRecord(const SampleRing::Slot& slot) {
+    if (format == SampleFormat::BINARY) {
+        // Record: u64 timestamp_ns, u32 sequence, u16 device, u16 length, data
+        std::fwrite(&slot.timestamp_ns, sizeof(slot.timestamp_ns), 1, out);
+        std::fwrite(&slot.sequence, sizeof(slot.sequence), 1, out);
+        std::fwrite(&slot.device, sizeof(slot.device), 1, out);
+        std::fwrite(&slot.length, sizeof(slot.length), 1, out);
+        std::fwrite(slot.data, 1, slot.length, out);
+        return;
+    }
+
+    static const char hex[] = "0123456789abcdef";
+    const std::string& device = device_names[slot.device];
+    int n = std::snprintf(line.data(), line.size(), "%llu,%u,%s,",
+                          static_cast<unsigned long long>(slot.timestamp_ns),
+                          slot.sequence, device.c_str());
+    char* p = line.data() + n;
+    for (uint16_t i = 0; i < slot.length; i++) {
+        if (i > 0) *p++ = ' ';
+        *p++ = hex[slot.data[i] >> 4];
+        *p++ = hex[slot.data[i] & 0x0F];
+    }
+    *p++ = '\n';
+    std::fwrite(line.data(), 1, p - line.data(), out);
+}
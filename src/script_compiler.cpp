@@ -0,0 +1,620 @@
+#include "script_compiler.hpp"
+#include "eeprom_geometry.hpp"
+#include "mapped_file.hpp"
+#include <algorithm>
+#include <filesystem>
+#include <charconv>
+#include <stdexcept>
+#include <iostream>
+
+const char* opCodeName(OpCode op) {
+    switch (op) {
+        case OpCode::WRITE:        return "WRITE";
+        case OpCode::WRITE1:       return "WRITE1";
+        case OpCode::WRITE16:      return "WRITE16";
+        case OpCode::READ:         return "READ";
+        case OpCode::READN:        return "READN";
+        case OpCode::READBLOCK:    return "READBLOCK";
+        case OpCode::POLL:         return "POLL";
+        case OpCode::DELAY:        return "DELAY";
+        case OpCode::FILE:         return "FILE";
+        case OpCode::LOOP:         return "LOOP";
+        case OpCode::LOOP_EVERY:   return "LOOP_EVERY";
+        case OpCode::SAMPLE:       return "SAMPLE";
+        case OpCode::ENDLOOP:      return "ENDLOOP";
+        case OpCode::START_RECORD: return "START_RECORD";
+        case OpCode::STOP_RECORD:  return "STOP_RECORD";
+        case OpCode::PRINT_RECORD: return "PRINT_RECORD";
+        case OpCode::CALIBRATE:    return "CALIBRATE";
+        case OpCode::SYNC:         return "SYNC";
+    }
+    return "?";
+}
+
+ScriptCompiler::ScriptCompiler(bool verbose_mode, ErrorAction action)
+    : verbose(verbose_mode), error_action(action) {
+}
+
+Program ScriptCompiler::compileFile(const std::string& filename) {
+    MappedFile file(filename, "input file");
+    if (include_stack.empty()) {
+        // A new top-level script starts with its own SUBs and includes
+        subroutines.clear();
+        call_cache.clear();
+        include_cache.clear();
+    }
+    // The stack starts with the top-level file so a cycle back to it is caught
+    include_stack.push_back(std::filesystem::weakly_canonical(filename).string());
+    try {
+        Program program = compileText(file.text(), filename);
+        include_stack.pop_back();
+        return program;
+    } catch (...) {
+        include_stack.pop_back();
+        throw;
+    }
+}
+
+Program ScriptCompiler::compileText(std::string_view text, const std::string& source) {
+    Program program;
+    program.source = source;
+    // One instruction per line at most
+    program.code.reserve(std::count(text.begin(), text.end(), '\n') + 1);
+
+    State state;
+    size_t pos = 0;
+    while (pos < text.size()) {
+        size_t eol = text.find('\n', pos);
+        if (eol == std::string_view::npos) eol = text.size();
+        compileLine(text.substr(pos, eol - pos), state, program);
+        pos = eol + 1;
+    }
+
+    finish(state, program);
+    return program;
+}
+
+void ScriptCompiler::compileLine(std::string_view line, State& state, Program& program) {
+    state.line_number++;
+
+    if (verbose) {
+        std::cout << "DEBUG: Line " << state.line_number << ": [" << line << "]\n";
+    }
+
+    // '#' starts a comment, also after a command. Operands are parsed
+    // strictly, so trailing comments must not reach them.
+    std::string_view trimmed_line = trim(line.substr(0, line.find('#')));
+    if (trimmed_line.empty()) {
+        if (verbose) {
+            std::cout << "DEBUG: Skipping line (empty or comment)\n";
+        }
+        return;
+    }
+
+    if (!state.header_skipped) {
+        state.header_skipped = true;
+        if (verbose) {
+            std::cout << "DEBUG: Skipping header line\n";
+        }
+        return;
+    }
+
+    try {
+        // SUB bodies are kept as text until a CALL supplies their arguments
+        if (!state.open_sub.empty()) {
+            std::string_view cmd = trim(trimmed_line.substr(0, trimmed_line.find(',')));
+            if (cmd == "ENDSUB") {
+                state.open_sub.clear();
+            } else if (cmd == "SUB") {
+                throw std::runtime_error("SUB inside SUB " + state.open_sub);
+            } else {
+                subroutines[state.open_sub].lines.emplace_back(state.line_number,
+                                                               std::string(trimmed_line));
+            }
+            return;
+        }
+
+        Tokens tokens;
+        size_t start = 0;
+        while (true) {
+            size_t comma = trimmed_line.find(',', start);
+            std::string_view token = trim(trimmed_line.substr(start, comma - start));
+            if (verbose) {
+                std::cout << "DEBUG: Parsed token: [" << token << "]\n";
+            }
+            tokens.push(substitute(token));
+            if (comma == std::string_view::npos) break;
+            start = comma + 1;
+        }
+
+        compileTokens(tokens, state, program);
+    } catch (const std::exception& e) {
+        std::cerr << "Error at ";
+        if (!call_stack.empty()) {
+            std::cerr << "SUB " << call_stack.back() << " ";
+        } else if (include_stack.size() > 1) {
+            std::cerr << include_stack.back() << " ";
+        }
+        std::cerr << "line " << state.line_number << ": " << e.what() << "\n";
+        if (error_action == ErrorAction::STOP) throw;
+    }
+}
+
+void ScriptCompiler::finish(const State& state, const Program& program) {
+    if (!state.atTopLevel()) {
+        throw std::runtime_error("Unterminated LOOP or SAMPLE in CSV");
+    }
+    if (!state.open_sub.empty()) {
+        throw std::runtime_error("Unterminated SUB " + state.open_sub + " in CSV");
+    }
+
+    if (verbose) {
+        std::cout << "DEBUG: Compiled " << program.code.size()
+                  << " instructions from " << program.source << "\n";
+    }
+}
+
+void ScriptCompiler::compileTokens(const Tokens& tokens, State& state, Program& program) {
+    std::vector<size_t>& open_loops = state.open_loops;
+    std::string_view cmd = tokens[0];
+    if (verbose) {
+        std::cout << "DEBUG: Command: [" << cmd << "]\n";
+    }
+
+    if (cmd == "TIMING") {
+        // Device timing profiles apply to the whole run, not a program position
+        if (tokens.size() != 5) throw std::runtime_error("Invalid TIMING format");
+        DeviceTiming timing;
+        timing.bus_free_us = parseInt(tokens[2], 0, UINT32_MAX, "TIMING bus free time");
+        timing.write_settle_us = parseInt(tokens[3], 0, UINT32_MAX, "TIMING settle time");
+        timing.conversion_us = parseInt(tokens[4], 0, UINT32_MAX, "TIMING conversion time");
+        program.timings.emplace_back(parseAddress(tokens[1]), timing);
+        return;
+    }
+    if (cmd == "INCLUDE") {
+        if (tokens.size() != 2 || tokens[1].empty()) throw std::runtime_error("Invalid INCLUDE format");
+        splice(include(tokens[1], program), state.line_number, program);
+        return;
+    }
+    if (cmd == "SUB") {
+        defineSub(tokens, state, program);
+        return;
+    }
+    if (cmd == "ENDSUB") {
+        throw std::runtime_error("ENDSUB without SUB");
+    }
+    if (cmd == "CALL") {
+        if (tokens.size() < 2 || tokens[1].empty()) throw std::runtime_error("Invalid CALL format");
+        splice(expandCall(tokens), state.line_number, program);
+        return;
+    }
+
+    Instruction ins;
+    ins.line = state.line_number;
+
+    if (cmd == "WRITE") {
+        if (tokens.size() != 4) throw std::runtime_error("Invalid WRITE format");
+        ins.op = OpCode::WRITE;
+        ins.addr = parseAddress(tokens[1]);
+        ins.reg = parseHex(tokens[2], 0, 0xFF, "Register");
+        ins.data = parseHex(tokens[3], 0, 0xFF, "WRITE data");
+    }
+    else if (cmd == "WRITE1") {
+        if (tokens.size() != 3) throw std::runtime_error("Invalid WRITE1 format");
+        ins.op = OpCode::WRITE1;
+        ins.addr = parseAddress(tokens[1]);
+        ins.data = parseHex(tokens[2], 0, 0xFF, "WRITE1 data");
+    }
+    else if (cmd == "WRITE16") {
+        if (tokens.size() != 4) throw std::runtime_error("Invalid WRITE16 format");
+        ins.op = OpCode::WRITE16;
+        ins.addr = parseAddress(tokens[1]);
+        ins.reg = parseHex(tokens[2], 0, 0xFF, "Register");
+        ins.data = parseHex(tokens[3], 0, 0xFFFF, "WRITE16 data");
+    }
+    else if (cmd == "READ") {
+        if (tokens.size() != 3) throw std::runtime_error("Invalid READ format");
+        ins.op = OpCode::READ;
+        ins.addr = parseAddress(tokens[1]);
+        ins.reg = parseHex(tokens[2], 0, 0xFF, "Register");
+    }
+    else if (cmd == "READN") {
+        if (tokens.size() != 4) throw std::runtime_error("Invalid READN format");
+        ins.op = OpCode::READN;
+        ins.addr = parseAddress(tokens[1]);
+        ins.reg = parseHex(tokens[2], 0, 0xFF, "Register");
+        ins.arg0 = parseInt(tokens[3], 1, 0xFFFF, "READN count");
+    }
+    else if (cmd == "READBLOCK") {
+        if (tokens.size() != 3) throw std::runtime_error("Invalid READBLOCK format");
+        ins.op = OpCode::READBLOCK;
+        ins.addr = parseAddress(tokens[1]);
+        ins.reg = parseHex(tokens[2], 0, 0xFF, "Register");
+    }
+    else if (cmd == "POLL") {
+        if (tokens.size() != 7 && tokens.size() != 8) throw std::runtime_error("Invalid POLL format");
+        PollSpec poll = parsePollTiming(tokens[5], tokens[6],
+                                        tokens.size() == 8 ? tokens[7] : std::string_view("0"));
+        PollCondition condition;
+        condition.addr = parseAddress(tokens[1]);
+        condition.reg = parseHex(tokens[2], 0, 0xFF, "Register");
+        condition.mask = parseHex(tokens[3], 0, 0xFF, "POLL mask");
+        condition.expected = parseHex(tokens[4], 0, 0xFF, "POLL expected value");
+        poll.conditions[poll.condition_count++] = condition;
+
+        ins.op = OpCode::POLL;
+        ins.addr = condition.addr;
+        ins.reg = condition.reg;
+        ins.arg0 = program.polls.size();
+        program.polls.push_back(poll);
+    }
+    else if (cmd == "POLL_ANY" || cmd == "POLL_ALL") {
+        // POLL_ANY,timeout,interval,holdoff,addr:reg:mask:exp,...
+        if (tokens.size() < 5 || tokens.size() > 4 + PollSpec::MAX_CONDITIONS) {
+            throw std::runtime_error("Invalid " + std::string(cmd) + " format");
+        }
+        PollSpec poll = parsePollTiming(tokens[1], tokens[2], tokens[3]);
+        poll.any = cmd == "POLL_ANY";
+        for (size_t i = 4; i < tokens.size(); i++) {
+            std::string_view fields[4];
+            std::string_view rest = tokens[i];
+            for (size_t f = 0; f < 4; f++) {
+                size_t colon = rest.find(':');
+                if ((colon == std::string_view::npos) != (f == 3)) {
+                    throw std::runtime_error("Invalid POLL condition: " + std::string(tokens[i]));
+                }
+                fields[f] = rest.substr(0, colon);
+                rest.remove_prefix(f == 3 ? rest.size() : colon + 1);
+            }
+            PollCondition condition;
+            condition.addr = parseAddress(fields[0]);
+            condition.reg = parseHex(fields[1], 0, 0xFF, "Register");
+            condition.mask = parseHex(fields[2], 0, 0xFF, "POLL mask");
+            condition.expected = parseHex(fields[3], 0, 0xFF, "POLL expected value");
+            poll.conditions[poll.condition_count++] = condition;
+        }
+
+        ins.op = OpCode::POLL;
+        ins.addr = poll.conditions[0].addr;
+        ins.reg = poll.conditions[0].reg;
+        ins.arg0 = program.polls.size();
+        program.polls.push_back(poll);
+    }
+    else if (cmd == "DELAY") {
+        if (tokens.size() != 2) throw std::runtime_error("Invalid DELAY format");
+        ins.op = OpCode::DELAY;
+        ins.arg0 = parseInt(tokens[1], 0, MAX_DELAY_US / 1000, "DELAY") * 1000;
+    }
+    else if (cmd == "DELAY_US") {
+        if (tokens.size() != 2) throw std::runtime_error("Invalid DELAY_US format");
+        ins.op = OpCode::DELAY;
+        ins.arg0 = parseInt(tokens[1], 0, MAX_DELAY_US, "DELAY_US");
+    }
+    else if (cmd == "FILE") {
+        if (tokens.size() != 4 && tokens.size() != 5) throw std::runtime_error("Invalid FILE format");
+        ins.op = OpCode::FILE;
+        ins.addr = parseAddress(tokens[1]);
+        ins.arg0 = addString(program, tokens[3]);
+        if (tokens.size() == 5) {
+            std::string type(tokens[4]);
+            int geometry = findEEPROMGeometry(type);
+            if (geometry < 0) throw std::runtime_error("Unknown EEPROM type: " + type);
+            ins.data = parseHex(tokens[2], 0, EEPROM_GEOMETRIES[geometry].size - 1,
+                                "EEPROM offset");
+            ins.arg1 = geometry + 1;
+        } else {
+            ins.reg = parseHex(tokens[2], 0, 0xFF, "Register");
+        }
+    }
+    else if (cmd == "SYNC") {
+        if (tokens.size() != 5) throw std::runtime_error("Invalid SYNC format");
+        ins.op = OpCode::SYNC;
+        ins.addr = parseAddress(tokens[1]);
+        ins.arg0 = addString(program, tokens[3]);
+        std::string type(tokens[4]);
+        int geometry = findEEPROMGeometry(type);
+        if (geometry < 0) throw std::runtime_error("Unknown EEPROM type: " + type);
+        ins.data = parseHex(tokens[2], 0, EEPROM_GEOMETRIES[geometry].size - 1, "EEPROM offset");
+        ins.arg1 = geometry + 1;
+    }
+    else if (cmd == "LOOP") {
+        if (tokens.size() != 2) throw std::runtime_error("Invalid LOOP format");
+        ins.op = OpCode::LOOP;
+        ins.arg0 = parseInt(tokens[1], 0, INT32_MAX, "LOOP count");
+        open_loops.push_back(program.code.size());
+    }
+    else if (cmd == "LOOP_EVERY") {
+        if (tokens.size() != 3) throw std::runtime_error("Invalid LOOP_EVERY format");
+        ins.op = OpCode::LOOP_EVERY;
+        ins.arg1 = parseInt(tokens[1], 1, INT32_MAX, "LOOP_EVERY period");
+        ins.arg0 = parseInt(tokens[2], 0, INT32_MAX, "LOOP_EVERY count");
+        open_loops.push_back(program.code.size());
+    }
+    else if (cmd == "SAMPLE") {
+        if (tokens.size() != 4) throw std::runtime_error("Invalid SAMPLE format");
+        ins.op = OpCode::SAMPLE;
+        double rate_hz = parseReal(tokens[1], "SAMPLE rate");
+        if (!(rate_hz > 0.0) || rate_hz > 1000000.0) throw std::runtime_error("SAMPLE rate out of range");
+        ins.arg1 = static_cast<int32_t>(1000000.0 / rate_hz + 0.5);
+        ins.arg0 = parseInt(tokens[2], 0, INT32_MAX, "SAMPLE count");
+        if (tokens[3].empty()) throw std::runtime_error("SAMPLE requires a device name");
+        ins.data = addString(program, tokens[3]);
+        open_loops.push_back(program.code.size());
+    }
+    else if (cmd == "ENDLOOP" || cmd == "ENDSAMPLE") {
+        std::string name(cmd);
+        if (open_loops.empty()) throw std::runtime_error(name + " without LOOP or SAMPLE");
+        bool is_sample = program.code[open_loops.back()].op == OpCode::SAMPLE;
+        if (is_sample != (cmd == "ENDSAMPLE")) {
+            throw std::runtime_error(name + " does not match open " +
+                                     (is_sample ? "SAMPLE" : "LOOP"));
+        }
+        ins.op = OpCode::ENDLOOP;
+        ins.jump = open_loops.back();
+        open_loops.pop_back();
+        program.code[ins.jump].jump = program.code.size();
+    }
+    else if (cmd == "START_RECORD") {
+        if (tokens.size() != 2) throw std::runtime_error("Invalid START_RECORD format");
+        ins.op = OpCode::START_RECORD;
+        ins.arg0 = parseInt(tokens[1], 0, INT32_MAX, "START_RECORD size");
+    }
+    else if (cmd == "STOP_RECORD") {
+        ins.op = OpCode::STOP_RECORD;
+    }
+    else if (cmd == "PRINT_RECORD") {
+        if (tokens.size() != 2) throw std::runtime_error("Invalid PRINT_RECORD format");
+        ins.op = OpCode::PRINT_RECORD;
+        ins.arg0 = addString(program, tokens[1]);
+    }
+    else if (cmd == "CALIBRATE") {
+        if (tokens.size() != 3) throw std::runtime_error("Invalid CALIBRATE format");
+        ins.op = OpCode::CALIBRATE;
+        ins.addr = parseAddress(tokens[1]);
+        ins.arg0 = addString(program, tokens[2]);
+    }
+    else {
+        throw std::runtime_error("Unknown command: " + std::string(cmd));
+    }
+
+    program.code.push_back(ins);
+}
+
+void ScriptCompiler::defineSub(const Tokens& tokens, State& state, const Program& program) {
+    if (tokens.size() < 2 || tokens.size() > Tokens::MAX_TOKENS || tokens[1].empty()) {
+        throw std::runtime_error("Invalid SUB format");
+    }
+    if (!state.atTopLevel()) throw std::runtime_error("SUB inside LOOP or SAMPLE");
+
+    std::string name(tokens[1]);
+    if (subroutines.count(name)) throw std::runtime_error("SUB " + name + " already defined");
+
+    Subroutine& sub = subroutines[name];
+    for (size_t i = 2; i < tokens.size(); i++) {
+        if (tokens[i].empty()) throw std::runtime_error("Empty parameter name in SUB " + name);
+        sub.params.emplace_back(tokens[i]);
+    }
+    sub.source = program.source;
+    state.open_sub = name;
+}
+
+std::string_view ScriptCompiler::substitute(std::string_view token) const {
+    if (!binding || token.size() < 2 || token[0] != '$') return token;
+
+    std::string_view param = token.substr(1);
+    for (size_t i = 0; i < binding->params.size(); i++) {
+        if (binding->params[i] == param) return (*binding_args)[i + 2];
+    }
+    throw std::runtime_error("Unknown parameter " + std::string(token));
+}
+
+const Program& ScriptCompiler::expandCall(const Tokens& tokens) {
+    std::string name(tokens[1]);
+    auto sub = subroutines.find(name);
+    if (sub == subroutines.end()) throw std::runtime_error("Unknown SUB: " + name);
+    if (tokens.size() - 2 != sub->second.params.size()) {
+        throw std::runtime_error("CALL " + name + " expects " +
+                                 std::to_string(sub->second.params.size()) + " argument(s)");
+    }
+
+    std::string key = name;
+    for (size_t i = 2; i < tokens.size(); i++) {
+        key += ',';
+        key += tokens[i];
+    }
+    auto cached = call_cache.find(key);
+    if (cached != call_cache.end()) return cached->second;
+
+    if (std::find(call_stack.begin(), call_stack.end(), name) != call_stack.end()) {
+        throw std::runtime_error("Recursive CALL of SUB " + name);
+    }
+
+    // Compile the body with the arguments bound; nested CALLs save and
+    // restore the outer binding
+    Program body;
+    body.source = sub->second.source;
+    const Subroutine* outer = binding;
+    const Tokens* outer_args = binding_args;
+    binding = &sub->second;
+    binding_args = &tokens;
+    call_stack.push_back(name);
+    try {
+        State state;
+        state.header_skipped = true;
+        for (const auto& line : sub->second.lines) {
+            state.line_number = line.first - 1;
+            compileLine(line.second, state, body);
+        }
+        if (!state.atTopLevel()) throw std::runtime_error("Unterminated LOOP or SAMPLE in SUB " + name);
+    } catch (...) {
+        binding = outer;
+        binding_args = outer_args;
+        call_stack.pop_back();
+        throw;
+    }
+    binding = outer;
+    binding_args = outer_args;
+    call_stack.pop_back();
+
+    return call_cache.emplace(key, std::move(body)).first->second;
+}
+
+const Program& ScriptCompiler::include(std::string_view path, const Program& program) {
+    std::filesystem::path file(path);
+    if (file.is_relative()) {
+        file = std::filesystem::path(program.source).parent_path() / file;
+    }
+    std::string key = std::filesystem::weakly_canonical(file).string();
+
+    auto cached = include_cache.find(key);
+    if (cached != include_cache.end()) return cached->second;
+
+    if (std::find(include_stack.begin(), include_stack.end(), key) != include_stack.end()) {
+        std::string chain;
+        for (const auto& entry : include_stack) chain += entry + " -> ";
+        throw std::runtime_error("Cyclic INCLUDE: " + chain + key);
+    }
+
+    Program included = compileFile(key);
+    return include_cache.emplace(key, std::move(included)).first->second;
+}
+
+void ScriptCompiler::splice(const Program& fragment, int line, Program& program) {
+    uint32_t base = program.code.size();
+    std::filesystem::path directory = std::filesystem::path(fragment.source).parent_path();
+
+    for (Instruction ins : fragment.code) {
+        ins.line = line;
+        switch (ins.op) {
+            case OpCode::LOOP:
+            case OpCode::LOOP_EVERY:
+            case OpCode::ENDLOOP:
+                ins.jump += base;
+                break;
+            case OpCode::SAMPLE:
+                ins.jump += base;
+                ins.data = addString(program, fragment.strings[ins.data]);
+                break;
+            case OpCode::FILE:
+            case OpCode::SYNC: {
+                // Data files are relative to the file that names them
+                std::filesystem::path data(fragment.strings[ins.arg0]);
+                if (data.is_relative()) {
+                    data = std::filesystem::absolute(directory / data);
+                }
+                ins.arg0 = addString(program, data.string());
+                break;
+            }
+            case OpCode::PRINT_RECORD:
+            case OpCode::CALIBRATE:
+                ins.arg0 = addString(program, fragment.strings[ins.arg0]);
+                break;
+            case OpCode::POLL:
+                program.polls.push_back(fragment.polls[ins.arg0]);
+                ins.arg0 = program.polls.size() - 1;
+                break;
+            default:
+                break;
+        }
+        program.code.push_back(ins);
+    }
+    program.timings.insert(program.timings.end(), fragment.timings.begin(), fragment.timings.end());
+}
+
+uint32_t ScriptCompiler::addString(Program& program, std::string_view str) {
+    for (size_t i = 0; i < program.strings.size(); i++) {
+        if (program.strings[i] == str) return i;
+    }
+    program.strings.emplace_back(str);
+    return program.strings.size() - 1;
+}
+
+std::string_view ScriptCompiler::trim(std::string_view str) {
+    size_t first = str.find_first_not_of(" \t\n\r");
+    if (first == std::string_view::npos) return std::string_view();
+    size_t last = str.find_last_not_of(" \t\n\r");
+    return str.substr(first, (last - first + 1));
+}
+
+static int64_t checkRange(std::string_view field, int64_t value, std::from_chars_result result,
+                          const char* end, int64_t min, int64_t max, const char* what) {
+    if (result.ec == std::errc::invalid_argument || result.ptr != end) {
+        throw std::runtime_error(std::string("Invalid ") + what + ": " + std::string(field));
+    }
+    if (result.ec == std::errc::result_out_of_range || value < min || value > max) {
+        throw std::runtime_error(std::string(what) + " out of range: " + std::string(field));
+    }
+    return value;
+}
+
+int64_t ScriptCompiler::parseHex(std::string_view field, int64_t min, int64_t max, const char* what) {
+    std::string_view digits = field;
+    if (digits.size() > 2 && digits[0] == '0' && (digits[1] == 'x' || digits[1] == 'X')) {
+        digits.remove_prefix(2);
+    }
+    int64_t value = 0;
+    const char* end = digits.data() + digits.size();
+    auto result = std::from_chars(digits.data(), end, value, 16);
+    return checkRange(field, value, result, end, min, max, what);
+}
+
+int64_t ScriptCompiler::parseInt(std::string_view field, int64_t min, int64_t max, const char* what) {
+    int64_t value = 0;
+    const char* end = field.data() + field.size();
+    auto result = std::from_chars(field.data(), end, value, 10);
+    return checkRange(field, value, result, end, min, max, what);
+}
+
+double ScriptCompiler::parseReal(std::string_view field, const char* what) {
+    double value = 0.0;
+    const char* end = field.data() + field.size();
+    auto result = std::from_chars(field.data(), end, value);
+    if (result.ec != std::errc() || result.ptr != end) {
+        throw std::runtime_error(std::string("Invalid ") + what + ": " + std::string(field));
+    }
+    return value;
+}
+
+uint32_t ScriptCompiler::parseDuration(std::string_view field, const char* what) {
+    std::string_view digits = field;
+    uint32_t scale = 1000;
+    if (digits.size() > 2 && digits.substr(digits.size() - 2) == "us") {
+        scale = 1;
+        digits.remove_suffix(2);
+    } else if (digits.size() > 2 && digits.substr(digits.size() - 2) == "ms") {
+        digits.remove_suffix(2);
+    } else if (digits.size() > 1 && digits.back() == 's') {
+        scale = 1000000;
+        digits.remove_suffix(1);
+    }
+    int64_t value = 0;
+    const char* end = digits.data() + digits.size();
+    auto result = std::from_chars(digits.data(), end, value, 10);
+    return checkRange(field, value, result, end, 0, UINT32_MAX / scale, what) * scale;
+}
+
+PollSpec ScriptCompiler::parsePollTiming(std::string_view timeout, std::string_view interval,
+                                         std::string_view holdoff) {
+    PollSpec poll;
+    poll.timeout_us = parseDuration(timeout, "POLL timeout");
+    poll.holdoff_us = parseDuration(holdoff, "POLL hold-off");
+
+    // "min..max" backs off from min to max, a single value keeps it fixed
+    size_t range = interval.find("..");
+    poll.min_interval_us = parseDuration(interval.substr(0, range), "POLL interval");
+    poll.max_interval_us = range == std::string_view::npos
+        ? poll.min_interval_us
+        : parseDuration(interval.substr(range + 2), "POLL interval");
+    // A zero step would never grow and read back to back until the timeout
+    if (poll.min_interval_us == 0) {
+        throw std::runtime_error("POLL interval must be at least 1us: " + std::string(interval));
+    }
+    if (poll.max_interval_us < poll.min_interval_us) {
+        throw std::runtime_error("POLL interval range is reversed: " + std::string(interval));
+    }
+    return poll;
+}
+
+uint8_t ScriptCompiler::parseAddress(std::string_view field) {
+    return parseHex(field, 0, 0x7F, "I2C address");
+}
@@ -0,0 +1,148 @@
+#include "script_stream.hpp"
+#include <cerrno>
+#include <cstring>
+#include <stdexcept>
+#include <vector>
+#include <fcntl.h>
+#include <poll.h>
+#include <unistd.h>
+
+ScriptStream::ScriptStream(const std::string& path, bool verbose, ErrorAction action)
+    : source(path), fd(STDIN_FILENO), owns_fd(false), compiler(verbose, action),
+      done(false), cancelled(false) {
+    if (path != "-") {
+        fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            throw std::runtime_error("Failed to open input file: " + path);
+        }
+        owns_fd = true;
+    }
+    parser = std::thread(&ScriptStream::parserLoop, this);
+}
+
+ScriptStream::~ScriptStream() {
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cancelled.store(true, std::memory_order_relaxed);
+    }
+    writable.notify_one();
+    parser.join();
+    if (owns_fd) {
+        close(fd);
+    }
+}
+
+std::unique_ptr<Program> ScriptStream::next() {
+    std::unique_lock<std::mutex> lock(mutex);
+    readable.wait(lock, [&] { return !queue.empty() || done; });
+    if (queue.empty()) {
+        if (error) std::rethrow_exception(error);
+        return nullptr;
+    }
+
+    std::unique_ptr<Program> block = std::move(queue.front());
+    queue.pop_front();
+    lock.unlock();
+    writable.notify_one();
+    return block;
+}
+
+bool ScriptStream::flush(std::unique_ptr<Program>& block) {
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        writable.wait(lock, [&] {
+            return queue.size() < QUEUE_DEPTH || cancelled.load(std::memory_order_relaxed);
+        });
+        if (cancelled.load(std::memory_order_relaxed)) return false;
+        queue.push_back(std::move(block));
+    }
+    readable.notify_one();
+    block = std::make_unique<Program>();
+    block->source = source;
+    return true;
+}
+
+bool ScriptStream::waitReadable() {
+    struct pollfd pfd = {fd, POLLIN, 0};
+    while (!cancelled.load(std::memory_order_relaxed)) {
+        int rc = poll(&pfd, 1, CANCEL_CHECK_MS);
+        if (rc > 0) return true;
+        if (rc < 0 && errno != EINTR) {
+            throw std::runtime_error(std::string("Failed to read script: ") + std::strerror(errno));
+        }
+    }
+    return false;
+}
+
+void ScriptStream::parserLoop() {
+    try {
+        ScriptCompiler::State state;
+        auto block = std::make_unique<Program>();
+        block->source = source;
+        std::vector<char> buffer(READ_CHUNK);
+        std::string partial;        // Line split across two reads
+
+        auto ready = [&]() {
+            return state.atTopLevel() && (!block->code.empty() || !block->timings.empty());
+        };
+
+        while (true) {
+            if (!waitReadable()) return;
+            ssize_t n = read(fd, buffer.data(), buffer.size());
+            if (n < 0) {
+                if (errno == EINTR || errno == EAGAIN) continue;
+                throw std::runtime_error(std::string("Failed to read script: ") + std::strerror(errno));
+            }
+            if (n == 0) break;
+
+            std::string_view chunk(buffer.data(), n);
+            size_t pos = 0;
+            size_t eol;
+            while ((eol = chunk.find('\n', pos)) != std::string_view::npos) {
+                std::string_view line = chunk.substr(pos, eol - pos);
+                if (!partial.empty()) {
+                    partial.append(line);
+                    compiler.compileLine(partial, state, *block);
+                    partial.clear();
+                } else {
+                    compiler.compileLine(line, state, *block);
+                }
+                pos = eol + 1;
+
+                // An open LOOP cannot be handed over before its ENDLOOP, so
+                // its body is buffered; refuse to buffer it without bound
+                if (!state.atTopLevel() &&
+                    block->code.size() - state.open_loops.front() > MAX_LOOP_INSTRUCTIONS) {
+                    throw std::runtime_error(
+                        "LOOP at line " + std::to_string(block->code[state.open_loops.front()].line) +
+                        " exceeds " + std::to_string(MAX_LOOP_INSTRUCTIONS) +
+                        " instructions without ENDLOOP");
+                }
+
+                if (state.atTopLevel() && block->code.size() >= MAX_BLOCK_INSTRUCTIONS &&
+                    !flush(block)) {
+                    return;
+                }
+            }
+            partial.append(chunk.substr(pos));
+
+            // The next read may block on a slow producer, so hand over
+            // everything that can already run
+            if (ready() && !flush(block)) return;
+        }
+
+        if (!partial.empty()) {
+            compiler.compileLine(partial, state, *block);
+        }
+        compiler.finish(state, *block);
+        if (ready()) flush(block);
+    } catch (...) {
+        std::lock_guard<std::mutex> lock(mutex);
+        error = std::current_exception();
+    }
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        done = true;
+    }
+    readable.notify_one();
+}
@@ -0,0 +1,85 @@
+#include "timing.hpp"
+#include <time.h>
+#include <cerrno>
+#include <algorithm>
+#include <iomanip>
+
+uint64_t monotonicNowNs() {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<uint64_t>(ts.tv_sec) * 1000000000ull + ts.tv_nsec;
+}
+
+void sleepUntilNs(uint64_t deadline_ns) {
+    struct timespec ts;
+    ts.tv_sec = deadline_ns / 1000000000ull;
+    ts.tv_nsec = deadline_ns % 1000000000ull;
+
+    // With TIMER_ABSTIME a signal interruption simply resumes towards the
+    // same deadline instead of restarting a relative sleep
+    while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, nullptr) == EINTR) {
+    }
+}
+
+void sleepForUs(uint64_t duration_us) {
+    if (duration_us == 0) return;
+    sleepUntilNs(monotonicNowNs() + duration_us * 1000ull);
+}
+
+void PeriodStats::add(uint64_t period_ns, uint64_t target_period_ns) {
+    // Jitter is the absolute deviation of each achieved period from the target
+    jitter.record(period_ns > target_period_ns ? period_ns - target_period_ns
+                                               : target_period_ns - period_ns);
+    min_ns = std::min(min_ns, period_ns);
+    max_ns = std::max(max_ns, period_ns);
+    total_ns += period_ns;
+}
+
+void PeriodStats::print(std::ostream& out, uint64_t target_period_us) const {
+    uint64_t periods = jitter.count();
+    out << periods << " periods, target " << target_period_us << " us";
+    if (periods == 0) {
+        out << "\n";
+        return;
+    }
+
+    out << std::fixed << std::setprecision(1)
+        << ", achieved min " << min_ns / 1000.0
+        << " us, avg " << total_ns / 1000.0 / periods
+        << " us, max " << max_ns / 1000.0
+        << " us, jitter p99 " << jitter.percentile(0.99) / 1000.0
+        << " us, max " << jitter.max() / 1000.0
+        << " us, overruns " << overruns << "\n";
+    out.unsetf(std::ios::floatfield);
+}
+
+void PollStats::add(uint64_t wait_ns, unsigned reads, bool satisfied) {
+    waits++;
+    total_reads += reads;
+    max_reads = std::max(max_reads, reads);
+    if (!satisfied) {
+        timeouts++;
+        return;
+    }
+    min_ns = std::min(min_ns, wait_ns);
+    max_ns = std::max(max_ns, wait_ns);
+    total_ns += wait_ns;
+}
+
+void PollStats::print(std::ostream& out) const {
+    out << waits << " waits, " << timeouts << " timeouts";
+    if (waits == 0) {
+        out << "\n";
+        return;
+    }
+    out << std::fixed << std::setprecision(1)
+        << ", reads avg " << static_cast<double>(total_reads) / waits << " max " << max_reads;
+    unsigned long met = waits - timeouts;
+    if (met > 0) {
+        out << ", satisfied after min " << min_ns / 1000.0
+            << " us, avg " << total_ns / 1000.0 / met
+            << " us, max " << max_ns / 1000.0 << " us";
+    }
+    out << "\n";
+    out.unsetf(std::ios::floatfield);
+}